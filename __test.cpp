@@ -121,12 +121,31 @@ int main() {
     std::cout << "ims10(join): " << ims10 << "\n";
     std::cout << "ims10a(concat): " << ims10a << "\n";
 
+    ks_immutable_string ims11 = ks_string_util::concat(ims1, "-", ms1, "", "-", ims1);
+    std::cout << "ims11(concat): " << ims11 << "\n";
+
     std::cout << "parse-int 100: " << ks_string_util::parse_int("100") << "\n";
     std::cout << "parse-double 100.2: " << ks_string_util::parse_double("100.2") << "\n";
     std::cout << "parse-bool true: " << ks_string_util::parse_bool("true") << "\n";
+    auto try_result = ks_string_util::try_parse_int32("42x");
+    std::cout << "try-parse-int32 42x: " << try_result.value << ", consumed " << try_result.consumed << "\n";
+
+    int32_t fields[4] = {};
+    ks_string_util::parse_int32_fields("1,2,3", ',', fields, 4);
+    std::cout << "parse-int32-fields 1,2,3: " << fields[0] << " " << fields[1] << " " << fields[2] << "\n";
 
     std::cout << "to-string 200: " << ks_string_util::to_string(200) << "\n";
     std::cout << "to-string true: " << ks_string_util::to_string(true) << "\n";
+    std::cout << "format: " << ks_string_util::format(KS_FORMAT_STRING("{} = {:08x}"), "a", 255) << "\n";
+#ifdef _WIN32
+    std::wcout << "format wide: " << ks_string_util::format(KS_FORMAT_STRING(u"port={}, ch={}"), uint16_t(8080), 'a') << "\n";
+#else
+    std::cout << "format wide: " << ks_string_util::wstring_to_u8_string(ks_string_util::format(KS_FORMAT_STRING(u"port={}, ch={}"), uint16_t(8080), 'a')) << "\n";
+#endif
+
+    std::cout << "hex-encode abc: " << ks_string_util::hex_encode("abc") << "\n";
+    std::cout << "base64-decode aGVsbG8=: " << ks_string_util::base64_decode("aGVsbG8=") << "\n";
+    std::cout << "percent-encode a b/c: " << ks_string_util::percent_encode("a b/c") << "\n";
 
 #ifdef _WIN32
     std::wcout << "convert utf8: " << ks_string_util::wstring_from_u8_chars(ks_string_util::wstring_to_std_u8_string((WCHAR*)u"大家好呀呀").c_str(), -1) << "\n";
@@ -138,6 +157,8 @@ int main() {
     std::cout << "convert utf32: " << ks_string_util::wstring_to_std_native_string(ks_string_util::wstring_from_u32_chars(ks_string_util::wstring_to_std_u32_string((WCHAR*)u"大家好呀呀").c_str(), -1)) << "\n";
     std::cout << "convert ansi: " << ks_string_util::wstring_to_std_native_string(ks_string_util::wstring_from_native_chars(ks_string_util::wstring_to_std_native_string((WCHAR*)u"大家好呀呀").c_str(), -1)) << "\n";
     std::cout << "convert wide: " << ks_string_util::wstring_to_std_native_string(ks_string_util::wstring_from_native_wide_chars(ks_string_util::wstring_to_std_native_wide_string((WCHAR*)u"大家好呀呀").c_str(), -1)) << "\n";
+    std::cout << "convert utf8 direct: " << ks_string_util::wstring_to_u8_string((WCHAR*)u"大家好呀呀") << "\n";
+    std::cout << "utf8 runes: " << ks_immutable_u8string(ks_wstring_view((WCHAR*)u"大家好呀呀")).substr(1, 3) << "\n";
 #endif
 
     //ks_mutable_string ms10;
@@ -17,6 +17,7 @@ limitations under the License.
 
 #include "base.h"
 #include "ks_basic_xmutable_string_base.h"
+#include "ks_number_chars.h"
 #include <istream>
 
 
@@ -155,6 +156,29 @@ public:
 		return *this;
 	}
 
+	//append formatted number... (formatted into the spare capacity directly, no temporary string)
+	//note: the float is written in the shortest round-trip form, see also ks_string_util::double_to_chars
+	ks_basic_mutable_string& append_int(int64_t v) {
+		this->template do_append_written<ks_string_util::max_number_chars>([v](ELEM* p) -> size_t { return ks_string_util::int64_to_chars(v, p); }, true);
+		return *this;
+	}
+	ks_basic_mutable_string& append_uint(uint64_t v) {
+		this->template do_append_written<ks_string_util::max_number_chars>([v](ELEM* p) -> size_t { return ks_string_util::uint64_to_chars(v, p); }, true);
+		return *this;
+	}
+	ks_basic_mutable_string& append_float(float v) {
+		this->template do_append_written<ks_string_util::max_number_chars>([v](ELEM* p) -> size_t { return ks_string_util::float_to_chars(v, p); }, true);
+		return *this;
+	}
+	ks_basic_mutable_string& append_double(double v) {
+		this->template do_append_written<ks_string_util::max_number_chars>([v](ELEM* p) -> size_t { return ks_string_util::double_to_chars(v, p); }, true);
+		return *this;
+	}
+	ks_basic_mutable_string& append_hex(uint64_t v, bool is_upper = false) {
+		this->template do_append_written<16>([v, is_upper](ELEM* p) -> size_t { return ks_string_util::uint64_to_hex_chars(v, p, is_upper); }, true);
+		return *this;
+	}
+
 	//insert... (by pos)
 	ks_basic_mutable_string& insert(size_t pos, const ELEM* p) {
 		this->do_insert(pos, __to_basic_string_view(p), true);
@@ -287,6 +311,12 @@ public:
 		return *this;
 	}
 
+	//apply edits... (all edits of the batch are applied in one rewriting)
+	ks_basic_mutable_string& apply_edits(const ks_basic_string_edit_batch<ELEM>& batch) {
+		this->do_apply_edits(batch, true);
+		return *this;
+	}
+
 	//fill...
 	ks_basic_mutable_string& fill(size_t pos, size_t number, ELEM ch) {
 		const size_t this_length = this->length();
@@ -368,10 +398,18 @@ public:
 
 	void reserve(size_t capa) {
 		this->do_reserve(capa);
-		this->do_ensure_exclusive(); //for compatibility, ensure exclusive！
+		this->do_ensure_exclusive(capa, true); //for compatibility, ensure exclusive！
 	}
 
 	//exclusive
+	void ensure_exclusive(size_t capa) {
+		//if shared, fork with exactly max(capa, length) capacity (no policy headroom), otherwise reserve capa
+		if (!this->is_exclusive())
+			this->do_ensure_exclusive(capa, false);
+		else
+			this->do_reserve(capa);
+	}
+
 	ELEM* __begin_exclusive_writing(size_t capa) {
 		this->do_resize(capa, ELEM{}, false, false);
 		this->do_ensure_exclusive();
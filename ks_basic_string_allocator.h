@@ -43,19 +43,9 @@ public:
     static const ELEM* address(const ELEM& _Val) { return std::addressof(_Val); }
 
     static ELEM* allocate(size_t _Count) {
-        if (_Count > 0x7FFFFFFFu)
-            throw std::bad_array_new_length();
-        _Count = ((_Count * sizeof(ELEM) + 3) & ~size_t(0x03)) / sizeof(ELEM);
-        size_t alloc_size = __header_size() + ((_Count * sizeof(ELEM) + 3) & ~size_t(0x03));
-        ASSERT(alloc_size % 4 == 0);
-        uintptr_t addr = (uintptr_t)malloc(alloc_size);
-        if (addr == 0)
-            throw std::bad_alloc();
-        ASSERT(addr % 4 == 0);
-        addr += __header_size();
-        *(uint32_t*)__get_space32_p((ELEM*)(addr)) = uint32_t(_Count);
-        *(uint32_t*)__get_refcount32_p((ELEM*)(addr)) = 0;
-        return (ELEM*)(addr);
+        ELEM* _Ptr = __alloc_block(nullptr, _Count);
+        *(uint32_t*)__get_refcount32_p(_Ptr) = 0;
+        return _Ptr;
     }
 
     static ELEM* allocate(size_t _Count, const void*) {
@@ -100,6 +90,13 @@ public:
         return _Ptr;
     }
 
+    static ELEM* _refcountful_realloc(ELEM* _Ptr, size_t _Count) {
+        //note: the refcount must be 1 (exclusive), the header is kept by realloc, and only the space32 is updated
+        ASSERT(_Ptr != nullptr);
+        ASSERT(_peek_refcount32_value(_Ptr) == 1);
+        return __alloc_block((void*)(uintptr_t(_Ptr) - __header_size()), _Count);
+    }
+
     static void _refcountful_initref(ELEM* _Ptr) {
         ASSERT(_Ptr != nullptr);
         ASSERT(_peek_refcount32_value(_Ptr) == 0);
@@ -122,6 +119,11 @@ public:
         }
     }
 
+    static constexpr size_t _round_count_to_page(size_t _Count, size_t page_size = 4096) {
+        //round up so that the whole allocation (with header) fills complete pages
+        return ((__header_size() + _Count * sizeof(ELEM) + page_size - 1) / page_size * page_size - __header_size()) / sizeof(ELEM);
+    }
+
     static constexpr uint32_t _get_space32_value(ELEM* p) {
         return *(uint32_t*)__get_space32_p(p);
     }
@@ -131,6 +133,22 @@ public:
     }
 
 private:
+    //malloc (or realloc the old block if given) for _Count elems rounded up to 4 bytes, and update the space32 only
+    static ELEM* __alloc_block(void* old_block, size_t _Count) {
+        if (_Count > 0x7FFFFFFFu)
+            throw std::bad_array_new_length();
+        _Count = ((_Count * sizeof(ELEM) + 3) & ~size_t(0x03)) / sizeof(ELEM);
+        size_t alloc_size = __header_size() + ((_Count * sizeof(ELEM) + 3) & ~size_t(0x03));
+        ASSERT(alloc_size % 4 == 0);
+        uintptr_t addr = (uintptr_t)(old_block == nullptr ? malloc(alloc_size) : realloc(old_block, alloc_size));
+        if (addr == 0)
+            throw std::bad_alloc();
+        ASSERT(addr % 4 == 0);
+        addr += __header_size();
+        *(uint32_t*)__get_space32_p((ELEM*)(addr)) = uint32_t(_Count);
+        return (ELEM*)(addr);
+    }
+
     static constexpr size_t __header_size() {
         static_assert(alignof(ELEM) < 8 ? true : alignof(ELEM) % 4 == 0, "the asign of larger ELEM type must be multi of 4");
         return alignof(ELEM) < 8 ? 8 : alignof(ELEM);
@@ -0,0 +1,79 @@
+﻿/* Copyright 2024 The Kingsoft's modern-string Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include "ks_string_view.h"
+#include <algorithm>
+#include <vector>
+
+template <class ELEM>
+class ks_basic_xmutable_string_base;
+
+
+//the edit-batch records many insert/erase/replace edits, and then they are applied to a mutable-string in one linear rewriting.
+//note:
+// all positions are based on the original string (before any edit of the batch is applied).
+// the edits must not overlap with each other, but they can be recorded in any order.
+// the batch does not own the replacement data, so the data must be alive until the batch is applied.
+template <class ELEM>
+class MODERN_STRING_API ks_basic_string_edit_batch {
+public:
+	ks_basic_string_edit_batch() = default;
+	ks_basic_string_edit_batch(const ks_basic_string_edit_batch& other) = default;
+	ks_basic_string_edit_batch& operator=(const ks_basic_string_edit_batch& other) = default;
+	ks_basic_string_edit_batch(ks_basic_string_edit_batch&& other) noexcept = default;
+	ks_basic_string_edit_batch& operator=(ks_basic_string_edit_batch&& other) noexcept = default;
+
+public:
+	ks_basic_string_edit_batch& insert(size_t pos, const ks_basic_string_view<ELEM>& str_view) {
+		return this->replace(pos, 0, str_view);
+	}
+
+	ks_basic_string_edit_batch& erase(size_t pos, size_t number) {
+		return this->replace(pos, number, ks_basic_string_view<ELEM>());
+	}
+
+	ks_basic_string_edit_batch& replace(size_t pos, size_t number, const ks_basic_string_view<ELEM>& str_view) {
+		_EDIT edit{ pos, number, str_view };
+		if (m_sorted && !m_edits.empty() && __edit_less(edit, m_edits.back()))
+			m_sorted = false;
+		m_edits.push_back(edit);
+		return *this;
+	}
+
+	void reserve(size_t n) { m_edits.reserve(n); }
+	void clear() { m_edits.clear(); m_sorted = true; }
+
+	size_t size() const { return m_edits.size(); }
+	bool empty() const { return m_edits.empty(); }
+
+private:
+	struct _EDIT {
+		size_t pos;
+		size_t number;
+		ks_basic_string_view<ELEM> str_view;
+	};
+
+	static bool __edit_less(const _EDIT& a, const _EDIT& b) {
+		//sorted by pos, and pure-inserts go before the others at the same pos
+		return a.pos != b.pos ? a.pos < b.pos : (a.number == 0 && b.number != 0);
+	}
+
+	std::vector<_EDIT> m_edits;
+	bool m_sorted = true;
+
+	friend class ks_basic_xmutable_string_base<ELEM>;
+};
@@ -22,10 +22,10 @@ void ks_basic_string_view<ELEM>::trim_left() {
 		constexpr ELEM space_chars[] = { ' ', '\t', '\r', '\n', '\f', '\v', '\0' };
 		constexpr size_t space_char_count = sizeof(space_chars) / sizeof(space_chars[0]);
 		size_t pos = this->find_first_not_of(space_chars, 0, space_char_count);
-		if (pos != size_t(-1))
-			m_p += pos;
-		else
-			m_p += m_length;
+		if (pos == size_t(-1))
+			pos = m_length;
+		m_p += pos;
+		m_length -= pos;
 	}
 }
 
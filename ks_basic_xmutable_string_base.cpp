@@ -15,3 +15,16 @@ limitations under the License.
 
 #include "base.h"
 #include "ks_basic_xmutable_string_base.h"
+#include <atomic>
+
+static std::atomic<int> g_string_grow_policy{ (int)ks_string_grow_policy::geometric_1_5x };
+
+MODERN_STRING_API
+ks_string_grow_policy ks_get_string_grow_policy() {
+	return (ks_string_grow_policy)g_string_grow_policy.load(std::memory_order_relaxed);
+}
+
+MODERN_STRING_API
+void ks_set_string_grow_policy(ks_string_grow_policy policy) {
+	g_string_grow_policy.store((int)policy, std::memory_order_relaxed);
+}
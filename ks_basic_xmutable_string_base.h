@@ -18,6 +18,7 @@ limitations under the License.
 #include "ks_string_view.h"
 #include "ks_basic_pointer_iterator.h"
 #include "ks_basic_string_allocator.h"
+#include "ks_basic_string_edit_batch.h"
 #include <algorithm>
 #include <stdexcept>
 #include <string>
@@ -30,6 +31,19 @@ template <class ELEM>
 class ks_basic_immutable_string;
 
 
+//the grow-policy is used when a string auto-grows (e.g. append, insert), reserve is always exact
+enum class ks_string_grow_policy {
+	geometric_1_5x = 0, //default
+	geometric_2x = 1,
+	page_rounded = 2, //geometric 1.5x, and the allocation is rounded up to whole pages when it is larger than one page
+};
+
+MODERN_STRING_API
+ks_string_grow_policy ks_get_string_grow_policy();
+MODERN_STRING_API
+void ks_set_string_grow_policy(ks_string_grow_policy policy);
+
+
 template <class ELEM>
 class MODERN_STRING_API ks_basic_xmutable_string_base {
 	static_assert(std::is_trivial_v<ELEM> && std::is_standard_layout_v<ELEM>, "ELEM must be pod type");
@@ -176,10 +190,12 @@ protected:
 		}
 	}
 
-	void do_ensure_exclusive();
+	void do_ensure_exclusive() { this->do_ensure_exclusive(this->length(), true); }
+	void do_ensure_exclusive(size_t min_capa, bool with_headroom);
 
 	bool do_determine_need_grow(size_t grow) { return ptrdiff_t(grow) > 0 && this->length() + grow > this->capacity(); }
 	void do_auto_grow(size_t grow);
+	static size_t do_calc_grown_capacity(size_t old_capa, size_t min_capa);
 
 	void do_reserve(size_t capa);
 
@@ -193,25 +209,27 @@ protected:
 
 	void do_trim(bool ensure_end_ch0) {
 		const auto this_view = this->view();
-		auto trimmed_view = this_view.trimmed();
+		const auto trimmed_view = this_view.trimmed();
 		if (trimmed_view.length() != this_view.length()) {
-			*this = this->unsafe_substr(trimmed_view.data() - this_view.data(), trimmed_view.length());
+			this->unsafe_self_substr(trimmed_view.data() - this_view.data(), trimmed_view.length());
 			this->do_ensure_end_ch0(ensure_end_ch0);
 		}
 	}
 	void do_trim_left(bool ensure_end_ch0) {
 		const auto this_view = this->view();
-		auto trimmed_view = this_view.trim_left();
+		auto trimmed_view = this_view;
+		trimmed_view.trim_left();
 		if (trimmed_view.length() != this_view.length()) {
-			*this = this->unsafe_substr(trimmed_view.data() - this_view.data(), trimmed_view.length());
+			this->unsafe_self_substr(trimmed_view.data() - this_view.data(), trimmed_view.length());
 			this->do_ensure_end_ch0(ensure_end_ch0);
 		}
 	}
 	void do_trim_right(bool ensure_end_ch0) {
 		const auto this_view = this->view();
-		auto trimmed_view = this_view.trim_right();
+		auto trimmed_view = this_view;
+		trimmed_view.trim_right();
 		if (trimmed_view.length() != this_view.length()) {
-			*this = this->unsafe_substr(trimmed_view.data() - this_view.data(), trimmed_view.length());
+			this->unsafe_self_substr(trimmed_view.data() - this_view.data(), trimmed_view.length());
 			this->do_ensure_end_ch0(ensure_end_ch0);
 		}
 	}
@@ -238,6 +256,27 @@ protected:
 		this->do_insert(this->length(), count, ch, ch_valid, ensure_end_ch0);
 	}
 
+	//append the elems written by write_fn (at most MAX_COUNT, and it returns the count written),
+	//into the spare capacity directly if it is enough, otherwise into a small buffer first and then the string grows by the exact count
+	template <size_t MAX_COUNT, class WRITE_FN>
+	void do_append_written(WRITE_FN write_fn, bool ensure_end_ch0) {
+		if (this->is_exclusive() && this->capacity() - this->length() >= MAX_COUNT) {
+			const size_t count = write_fn(this->unsafe_data_end());
+			ASSERT(count <= MAX_COUNT);
+			if (this->is_sso_mode())
+				_my_sso_ptr()->length8 += uint8_t(count);
+			else
+				_my_ref_ptr()->length32 += uint32_t(count);
+			this->do_ensure_end_ch0(ensure_end_ch0);
+		}
+		else {
+			ELEM buf[MAX_COUNT];
+			const size_t count = write_fn(buf);
+			ASSERT(count <= MAX_COUNT);
+			this->do_append(ks_basic_string_view<ELEM>(buf, count), ensure_end_ch0);
+		}
+	}
+
 	void do_insert(size_t pos, const ks_basic_string_view<ELEM>& str_view, bool ensure_end_ch0);
 	void do_insert(size_t pos, size_t count, ELEM ch, bool ch_valid, bool ensure_end_ch0);
 
@@ -246,6 +285,8 @@ protected:
 
 	size_t do_substitute_n(const ks_basic_string_view<ELEM>& sub, const ks_basic_string_view<ELEM>& replacement, size_t n, bool ensure_end_ch0);
 
+	void do_apply_edits(const ks_basic_string_edit_batch<ELEM>& batch, bool ensure_end_ch0);
+
 	void do_erase(size_t pos, size_t number, bool ensure_end_ch0);
 	void do_clear(bool ensure_end_ch0);
 
@@ -340,6 +381,24 @@ protected:
 		}
 	}
 
+	//narrow this to [pos, pos+count) in place: the ref-mode only adjusts offset and length on the same buffer (no addref/release), and the sso-mode shifts its buffer
+	void unsafe_self_substr(size_t pos, size_t count) {
+		ASSERT(pos <= this->length() && count <= this->length() - pos);
+		if (this->is_sso_mode()) {
+			auto* sso_ptr = _my_sso_ptr();
+			if (pos != 0)
+				std::move(sso_ptr->buffer + pos, sso_ptr->buffer + pos + count, sso_ptr->buffer);
+			sso_ptr->length8 = uint8_t(count);
+			sso_ptr->buffer[count] = 0;
+		}
+		else {
+			auto* ref_ptr = _my_ref_ptr();
+			ref_ptr->p += (ptrdiff_t)pos;
+			ref_ptr->offset32 += (uint32_t)pos;
+			ref_ptr->length32 = (uint32_t)count;
+		}
+	}
+
 	ks_basic_string_view<ELEM> unsafe_whole_view() const {
 		if (this->is_sso_mode()) {
 			auto* sso_ptr = _my_sso_ptr();
@@ -413,7 +472,8 @@ public:
 	}
 
 	bool is_exclusive() const {
-		return !(this->is_ref_mode() && !_my_ref_ptr()->constantFlag && ks_basic_string_allocator<ELEM>::_peek_refcount32_value(_my_ref_ptr()->alloc_addr(), false) > 1); //note: no need to acquire
+		//note: a constant string is never exclusive, because its data is not writable
+		return !(this->is_ref_mode() && (_my_ref_ptr()->constantFlag || ks_basic_string_allocator<ELEM>::_peek_refcount32_value(_my_ref_ptr()->alloc_addr(), false) > 1)); //note: no need to acquire
 	}
 
 	ks_basic_string_view<ELEM> view() const {
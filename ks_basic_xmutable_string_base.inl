@@ -99,13 +99,25 @@ ks_basic_xmutable_string_base<ELEM>::ks_basic_xmutable_string_base(std::basic_st
 }
 
 template <class ELEM>
-void ks_basic_xmutable_string_base<ELEM>::do_ensure_exclusive() {
+void ks_basic_xmutable_string_base<ELEM>::do_ensure_exclusive(size_t min_capa, bool with_headroom) {
 	if (!this->is_exclusive()) {
+		//the forked capacity is determined by the live length (plus the policy headroom, but not more than the original capacity),
+		//so that mutating a small slice of a huge shared buffer won't fork the whole capacity
 		const size_t my_length = this->length();
-		const size_t my_capacity = this->capacity();
-		ELEM* forked_alloc_addr = ks_basic_string_allocator<ELEM>::_refcountful_alloc(my_capacity + 1);
+		size_t forked_capa = std::max(min_capa, my_length);
+		if (with_headroom)
+			forked_capa = std::max(forked_capa, std::min(this->capacity(), do_calc_grown_capacity(my_length, my_length)));
+		if (forked_capa > _STR_LENGTH_LIMIT)
+			throw std::overflow_error("ks_basic_xmutable_string_base::ensure_exclusive(capa) overflow exception");
+
+		if (forked_capa <= _SSO_BUFFER_SPACE - 1) {
+			*this = ks_basic_xmutable_string_base(this->data(), my_length);
+			return;
+		}
+
+		ELEM* forked_alloc_addr = ks_basic_string_allocator<ELEM>::_refcountful_alloc(forked_capa + 1);
 		std::copy_n(this->data(), my_length, forked_alloc_addr);
-		std::fill_n(forked_alloc_addr + my_length, my_capacity - my_length + 1, 0); //with z
+		forked_alloc_addr[my_length] = 0; //the slack need not be zero-filled
 
 		ks_basic_xmutable_string_base forked;
 		auto* forked_ref_ptr = forked._my_ref_ptr();
@@ -122,8 +134,7 @@ void ks_basic_xmutable_string_base<ELEM>::do_ensure_exclusive() {
 template <class ELEM>
 void ks_basic_xmutable_string_base<ELEM>::do_auto_grow(size_t grow) {
 	if (this->do_determine_need_grow(grow)) {
-		const size_t my_capacity = this->capacity();
-		size_t new_capa = std::max(this->length() + grow, my_capacity + my_capacity / 2);
+		size_t new_capa = do_calc_grown_capacity(this->capacity(), this->length() + grow);
 		if (new_capa > _STR_LENGTH_LIMIT) {
 			new_capa = _STR_LENGTH_LIMIT;
 			if (new_capa < this->length() + grow)
@@ -134,6 +145,21 @@ void ks_basic_xmutable_string_base<ELEM>::do_auto_grow(size_t grow) {
 	}
 }
 
+template <class ELEM>
+size_t ks_basic_xmutable_string_base<ELEM>::do_calc_grown_capacity(size_t old_capa, size_t min_capa) {
+	switch (ks_get_string_grow_policy()) {
+	case ks_string_grow_policy::geometric_2x:
+		return std::max(min_capa, old_capa * 2);
+	case ks_string_grow_policy::page_rounded: {
+		const size_t new_capa = std::max(min_capa, old_capa + old_capa / 2);
+		const size_t page_capa = ks_basic_string_allocator<ELEM>::_round_count_to_page(new_capa + 1) - 1;
+		return (new_capa + 1) * sizeof(ELEM) >= 4096 ? page_capa : new_capa;
+	}
+	default:
+		return std::max(min_capa, old_capa + old_capa / 2);
+	}
+}
+
 template <class ELEM>
 void ks_basic_xmutable_string_base<ELEM>::do_reserve(size_t capa) {
 	if (capa > this->capacity()) {
@@ -147,6 +173,13 @@ void ks_basic_xmutable_string_base<ELEM>::do_reserve(size_t capa) {
 		if (new_capa <= _SSO_BUFFER_SPACE - 1) {
 			*this = ks_basic_xmutable_string_base(this->data(), this->length());
 		}
+		else if (this->is_ref_mode() && !_my_ref_ptr()->constantFlag && _my_ref_ptr()->offset32 == 0 && this->is_exclusive()) {
+			//exclusive and refcount-owned, so we try to grow in place, and realloc may extend the mapping without copying
+			auto* ref_ptr = _my_ref_ptr();
+			ELEM* grown_alloc_addr = ks_basic_string_allocator<ELEM>::_refcountful_realloc(ref_ptr->alloc_addr(), new_capa + 1);
+			std::fill_n(grown_alloc_addr + ref_ptr->length32, new_capa - ref_ptr->length32 + 1, 0); //the slack is zero-filled like the copying path
+			ref_ptr->p = grown_alloc_addr;
+		}
 		else {
 			ELEM* grown_alloc_addr = ks_basic_string_allocator<ELEM>::_refcountful_alloc(new_capa + 1);
 			std::copy_n(this->data(), this->length(), grown_alloc_addr);
@@ -224,9 +257,9 @@ void ks_basic_xmutable_string_base<ELEM>::do_insert(size_t pos, const ks_basic_s
 
 	auto do_insert_imp = [this, pos](const ks_basic_string_view<ELEM>& str_view, bool ensure_end_ch0) -> void {
 		this->do_auto_grow(str_view.length());
-		this->do_ensure_exclusive();
+		this->do_ensure_exclusive(this->length() + str_view.length(), true);
 
-		std::move_backward(this->data() + pos, this->data() + pos + str_view.length(), this->unsafe_data_end() + str_view.length());
+		std::move_backward(this->data() + pos, this->data_end(), this->unsafe_data_end() + str_view.length());
 		std::copy_n(str_view.data(), str_view.length(), this->unsafe_data() + pos);
 
 		if (this->is_sso_mode())
@@ -254,9 +287,9 @@ void ks_basic_xmutable_string_base<ELEM>::do_insert(size_t pos, size_t count, EL
 		return;
 
 	this->do_auto_grow(count);
-	this->do_ensure_exclusive();
+	this->do_ensure_exclusive(this->length() + count, true);
 
-	std::move_backward(this->data() + pos, this->data() + pos + count, this->unsafe_data_end() + count);
+	std::move_backward(this->data() + pos, this->data_end(), this->unsafe_data_end() + count);
 
 	if (ch_valid)
 		std::fill_n(this->unsafe_data() + pos, count, ch);
@@ -299,12 +332,12 @@ void ks_basic_xmutable_string_base<ELEM>::do_replace(size_t pos, size_t number,
 	auto do_replace_imp = [this, pos, pos_end, len_delta](const ks_basic_string_view<ELEM>& str_view, bool ensure_end_ch0) -> void {
 		if (len_delta > 0)
 			this->do_auto_grow(len_delta);
-		this->do_ensure_exclusive();
+		this->do_ensure_exclusive(this->length() + std::max(len_delta, ptrdiff_t(0)), true);
 
 		if (len_delta < 0)
 			std::move(this->data() + pos_end, this->data_end(), this->unsafe_data() + pos_end + len_delta);
 		else if (len_delta > 0)
-			std::move_backward(this->data() + pos_end, this->data_end(), this->unsafe_data() + pos_end + len_delta);
+			std::move_backward(this->data() + pos_end, this->data_end(), this->unsafe_data_end() + len_delta);
 
 		std::copy_n(str_view.data(), str_view.length(), this->unsafe_data() + pos);
 
@@ -342,12 +375,12 @@ void ks_basic_xmutable_string_base<ELEM>::do_replace(size_t pos, size_t number,
 
 	if (len_delta > 0)
 		this->do_auto_grow(len_delta);
-	this->do_ensure_exclusive();
+	this->do_ensure_exclusive(this->length() + std::max(len_delta, ptrdiff_t(0)), true);
 
 	if (len_delta < 0)
 		std::move(this->data() + pos_end, this->data_end(), this->unsafe_data() + pos_end + len_delta);
 	else if (len_delta > 0)
-		std::move_backward(this->data() + pos_end, this->data_end(), this->unsafe_data() + pos_end + len_delta);
+		std::move_backward(this->data() + pos_end, this->data_end(), this->unsafe_data_end() + len_delta);
 
 	if (ch_valid)
 		std::fill_n(this->unsafe_data() + pos, count, ch);
@@ -435,7 +468,7 @@ size_t ks_basic_xmutable_string_base<ELEM>::do_substitute_n(const ks_basic_strin
 	auto do_substitute_apply = [this, &pos32_list, sub_length = sub.length(), len_delta_total](const ks_basic_string_view<ELEM>& replacement, bool ensure_end_ch0) -> void {
 		if (len_delta_total > 0)
 			this->do_auto_grow(len_delta_total);
-		this->do_ensure_exclusive();
+		this->do_ensure_exclusive(this->length() + std::max(len_delta_total, ptrdiff_t(0)), true);
 
 		ELEM* that_data = this->unsafe_data();
 		ELEM* that_data_end = this->unsafe_data_end();
@@ -507,6 +540,121 @@ size_t ks_basic_xmutable_string_base<ELEM>::do_substitute_n(const ks_basic_strin
 	return pos32_list.size();
 }
 
+template <class ELEM>
+void ks_basic_xmutable_string_base<ELEM>::do_apply_edits(const ks_basic_string_edit_batch<ELEM>& batch, bool ensure_end_ch0) {
+	using _EDIT = typename ks_basic_string_edit_batch<ELEM>::_EDIT;
+	if (batch.empty())
+		return;
+
+	std::vector<_EDIT> sorted_edits_dup;
+	const std::vector<_EDIT>* edits = &batch.m_edits;
+	if (!batch.m_sorted) {
+		sorted_edits_dup = batch.m_edits;
+		std::stable_sort(sorted_edits_dup.begin(), sorted_edits_dup.end(), &ks_basic_string_edit_batch<ELEM>::__edit_less);
+		edits = &sorted_edits_dup;
+	}
+
+	//validate all edits, and measure the final length
+	const size_t this_length = this->length();
+	const auto this_whole_view = this->unsafe_whole_view();
+	auto get_edit_number = [this_length](const _EDIT& edit) -> size_t {
+		return ptrdiff_t(edit.number) < 0 && edit.pos <= this_length ? this_length - edit.pos : edit.number;
+	};
+
+	bool is_argview_safe = true;
+	ptrdiff_t len_delta_total = 0;
+	size_t prev_pos_end = 0;
+	for (const _EDIT& edit : *edits) {
+		const size_t number = get_edit_number(edit);
+		if (edit.pos < prev_pos_end || edit.pos > this_length || number > this_length - edit.pos)
+			throw std::out_of_range("ks_basic_xmutable_string_base::apply_edits(batch) out-of-range or overlapped exception");
+		prev_pos_end = edit.pos + number;
+		len_delta_total += (ptrdiff_t)edit.str_view.length() - (ptrdiff_t)number;
+		if (edit.str_view.is_overlapped_with(this_whole_view))
+			is_argview_safe = false;
+	}
+
+	const size_t new_length = this_length + len_delta_total;
+	if (new_length > _STR_LENGTH_LIMIT)
+		throw std::overflow_error("ks_basic_xmutable_string_base::apply_edits(batch) overflow exception");
+
+	if (is_argview_safe && this->is_exclusive() && new_length <= this->capacity()) {
+		//rewrite in place:
+		//1. the kept segments which shift to left are moved from left to right,
+		//2. the kept segments which shift to right are moved from right to left,
+		//3. then all replacements are written into the gaps.
+		//the destinations of the kept segments keep their order, so no segment would be overwritten before being moved.
+		ELEM* that_data = this->unsafe_data();
+
+		ptrdiff_t shift = 0;
+		size_t read_pos = 0;
+		for (const _EDIT& edit : *edits) {
+			if (shift < 0)
+				std::move(that_data + read_pos, that_data + edit.pos, that_data + read_pos + shift);
+			const size_t number = get_edit_number(edit);
+			shift += (ptrdiff_t)edit.str_view.length() - (ptrdiff_t)number;
+			read_pos = edit.pos + number;
+		}
+		if (shift < 0)
+			std::move(that_data + read_pos, that_data + this_length, that_data + read_pos + shift);
+
+		shift = len_delta_total;
+		size_t read_pos_end = this_length;
+		for (auto it = edits->rbegin(); it != edits->rend(); ++it) {
+			const size_t number = get_edit_number(*it);
+			if (shift > 0)
+				std::move_backward(that_data + it->pos + number, that_data + read_pos_end, that_data + read_pos_end + shift);
+			shift -= (ptrdiff_t)it->str_view.length() - (ptrdiff_t)number;
+			read_pos_end = it->pos;
+		}
+		ASSERT(shift == 0);
+
+		for (const _EDIT& edit : *edits) {
+			std::copy_n(edit.str_view.data(), edit.str_view.length(), that_data + edit.pos + shift);
+			shift += (ptrdiff_t)edit.str_view.length() - (ptrdiff_t)get_edit_number(edit);
+		}
+
+		if (this->is_sso_mode())
+			_my_sso_ptr()->length8 = uint8_t(new_length);
+		else
+			_my_ref_ptr()->length32 = uint32_t(new_length);
+	}
+	else {
+		//rewrite into a new buffer, reading from the old buffer which is kept alive until the end
+		const size_t new_capa = new_length <= this->capacity() ? new_length : do_calc_grown_capacity(this->capacity(), new_length);
+		ks_basic_xmutable_string_base rewritten;
+		ELEM* rewritten_data = rewritten._my_sso_ptr()->buffer;
+		if (new_capa > _SSO_BUFFER_SPACE - 1) {
+			rewritten_data = ks_basic_string_allocator<ELEM>::_refcountful_alloc(new_capa + 1);
+			auto* rewritten_ref_ptr = rewritten._my_ref_ptr();
+			rewritten_ref_ptr->mode = _REF_MODE;
+			rewritten_ref_ptr->offset32 = 0;
+			rewritten_ref_ptr->length32 = uint32_t(new_length);
+			rewritten_ref_ptr->constantFlag = false;
+			rewritten_ref_ptr->p = rewritten_data;
+		}
+		else {
+			rewritten._my_sso_ptr()->length8 = uint8_t(new_length);
+		}
+
+		const ELEM* this_data = this->data();
+		ELEM* write_p = rewritten_data;
+		size_t read_pos = 0;
+		for (const _EDIT& edit : *edits) {
+			write_p = std::copy(this_data + read_pos, this_data + edit.pos, write_p);
+			write_p = std::copy_n(edit.str_view.data(), edit.str_view.length(), write_p);
+			read_pos = edit.pos + get_edit_number(edit);
+		}
+		write_p = std::copy(this_data + read_pos, this_data + this_length, write_p);
+		ASSERT(write_p == rewritten_data + new_length);
+		*write_p = 0;
+
+		*this = std::move(rewritten);
+	}
+
+	this->do_ensure_end_ch0(ensure_end_ch0);
+}
+
 template <class ELEM>
 void ks_basic_xmutable_string_base<ELEM>::do_erase(size_t pos, size_t number, bool ensure_end_ch0) {
 	if (ptrdiff_t(number) < 0)
@@ -521,6 +669,12 @@ void ks_basic_xmutable_string_base<ELEM>::do_erase(size_t pos, size_t number, bo
 	if (pos == 0 && number == this->length())
 		return this->do_clear(ensure_end_ch0);
 
+	if (pos == 0 && this->is_ref_mode()) {
+		//erasing the head of a ref-string only moves the offset, so no data moving and no forking
+		this->unsafe_self_substr(number, this->length() - number);
+		return this->do_ensure_end_ch0(ensure_end_ch0);
+	}
+
 	if (pos_end < this->length()) {
 		this->do_ensure_exclusive();
 		std::move(this->data() + pos_end, this->data_end(), this->unsafe_data() + pos);
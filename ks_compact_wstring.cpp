@@ -0,0 +1,117 @@
+﻿/* Copyright 2024 The Kingsoft's modern-string Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "ks_compact_wstring.h"
+
+//probe and narrow in one pass, return false (and latin1 is left empty) if any unit is above 0xFF
+static bool __try_narrow_latin1(const ks_wstring_view& wstr_view, ks_mutable_string* latin1) {
+	char* latin1_data = latin1->__begin_exclusive_writing(wstr_view.length());
+	const bool is_latin1 = ks_string_util::__try_narrow_to_latin1(wstr_view.data(), wstr_view.length(), latin1_data);
+	latin1->__end_exclusive_writing(latin1_data, is_latin1 ? wstr_view.length() : 0);
+	return is_latin1;
+}
+
+ks_compact_wstring::ks_compact_wstring() : m_latin1(), m_is_compact(true) {
+}
+
+ks_compact_wstring::ks_compact_wstring(const ks_wstring_view& wstr_view) : m_is_compact(true) {
+	//note: the narrowing stops at the first unit above 0xFF, so the wide string only costs the dropped byte buffer
+	ks_mutable_string latin1;
+	if (__try_narrow_latin1(wstr_view, &latin1)) {
+		new (&m_latin1) ks_immutable_string(std::move(latin1));
+	}
+	else {
+		new (&m_wide) ks_immutable_wstring(wstr_view);
+		m_is_compact = false;
+	}
+}
+
+ks_compact_wstring::ks_compact_wstring(const ks_immutable_wstring& wstr) : m_is_compact(true) {
+	ks_mutable_string latin1;
+	if (__try_narrow_latin1(wstr, &latin1)) {
+		new (&m_latin1) ks_immutable_string(std::move(latin1));
+	}
+	else {
+		new (&m_wide) ks_immutable_wstring(wstr); //shared
+		m_is_compact = false;
+	}
+}
+
+ks_compact_wstring::ks_compact_wstring(const ks_compact_wstring& other) : m_is_compact(other.m_is_compact) {
+	if (m_is_compact)
+		new (&m_latin1) ks_immutable_string(other.m_latin1);
+	else
+		new (&m_wide) ks_immutable_wstring(other.m_wide);
+}
+
+ks_compact_wstring::ks_compact_wstring(ks_compact_wstring&& other) noexcept : m_is_compact(other.m_is_compact) {
+	if (m_is_compact)
+		new (&m_latin1) ks_immutable_string(std::move(other.m_latin1));
+	else
+		new (&m_wide) ks_immutable_wstring(std::move(other.m_wide));
+}
+
+ks_compact_wstring& ks_compact_wstring::operator=(const ks_compact_wstring& other) {
+	if (this != &other)
+		*this = ks_compact_wstring(other);
+	return *this;
+}
+
+ks_compact_wstring& ks_compact_wstring::operator=(ks_compact_wstring&& other) noexcept {
+	if (this != &other) {
+		this->__destroy();
+		m_is_compact = other.m_is_compact;
+		if (m_is_compact)
+			new (&m_latin1) ks_immutable_string(std::move(other.m_latin1));
+		else
+			new (&m_wide) ks_immutable_wstring(std::move(other.m_wide));
+	}
+	return *this;
+}
+
+ks_compact_wstring::~ks_compact_wstring() {
+	this->__destroy();
+}
+
+void ks_compact_wstring::__destroy() noexcept {
+	if (m_is_compact)
+		m_latin1.~ks_immutable_string();
+	else
+		m_wide.~ks_immutable_wstring();
+}
+
+size_t ks_compact_wstring::copy_to(WCHAR* dst, size_t dst_capacity, size_t pos) const {
+	const size_t length = this->length();
+	if (pos > length)
+		throw std::out_of_range("ks_compact_wstring::copy_to(dst, dst_capacity, pos) out-of-range exception");
+
+	const size_t count = (std::min)(length - pos, dst_capacity);
+	if (m_is_compact)
+		ks_string_util::wstring_from_latin1_chars(m_latin1.data() + pos, count, dst, count);
+	else
+		std::copy_n(m_wide.data() + pos, count, dst);
+	return count;
+}
+
+ks_immutable_wstring ks_compact_wstring::to_wstring() const {
+	return m_is_compact ? ks_string_util::wstring_from_latin1_chars(m_latin1.data(), m_latin1.length()) : m_wide;
+}
+
+bool ks_compact_wstring::operator==(const ks_compact_wstring& right) const {
+	//note: the same content is always stored in the same form, so the forms are compared first
+	if (m_is_compact != right.m_is_compact)
+		return false;
+	return m_is_compact ? m_latin1.view() == right.m_latin1.view() : m_wide.view() == right.m_wide.view();
+}
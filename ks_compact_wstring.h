@@ -0,0 +1,73 @@
+﻿/* Copyright 2024 The Kingsoft's modern-string Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include "ks_string_util_convert.h"
+
+//the immutable-wstring which stores its units by bytes when all of them are latin1 (not above 0xFF), similar to the compact strings of jvm.
+//note: the compact data is widened on demand, by operator[], copy_to() or to_wstring(),
+//and a wide (not compactable) string is shared with the source as an ordinary ks_immutable_wstring.
+class MODERN_STRING_API ks_compact_wstring {
+public:
+	ks_compact_wstring();
+	explicit ks_compact_wstring(const ks_wstring_view& wstr_view);
+	explicit ks_compact_wstring(const ks_immutable_wstring& wstr);
+
+	ks_compact_wstring(const ks_compact_wstring& other);
+	ks_compact_wstring& operator=(const ks_compact_wstring& other);
+	ks_compact_wstring(ks_compact_wstring&& other) noexcept;
+	ks_compact_wstring& operator=(ks_compact_wstring&& other) noexcept;
+	~ks_compact_wstring();
+
+public:
+	bool is_compact() const { return m_is_compact; }
+	size_t length() const { return m_is_compact ? m_latin1.length() : m_wide.length(); }
+	bool empty() const { return this->length() == 0; }
+
+	WCHAR operator[](size_t index) const {
+		ASSERT(index < this->length());
+		return m_is_compact ? (WCHAR)(uint8_t)m_latin1.data()[index] : m_wide.data()[index];
+	}
+
+	WCHAR at(size_t index) const {
+		if (index >= this->length())
+			throw std::out_of_range("ks_compact_wstring::at(index) out-of-range exception");
+		return (*this)[index];
+	}
+
+	//the underlying data, latin1_view() is valid only when is_compact(), and wide_view() is valid only when !is_compact()
+	ks_string_view latin1_view() const { ASSERT(m_is_compact); return m_latin1.view(); }
+	ks_wstring_view wide_view() const { ASSERT(!m_is_compact); return m_wide.view(); }
+
+	//return the count copied (not zero-terminated), the units are widened if compact
+	size_t copy_to(WCHAR* dst, size_t dst_capacity, size_t pos = 0) const;
+
+	ks_immutable_wstring to_wstring() const;
+
+	bool operator==(const ks_compact_wstring& right) const;
+	bool operator!=(const ks_compact_wstring& right) const { return !(*this == right); }
+
+private:
+	void __destroy() noexcept;
+
+private:
+	//only one of them is alive, as m_is_compact tells, so the object is no larger than a ks_immutable_wstring and a flag
+	union {
+		ks_immutable_string m_latin1;
+		ks_immutable_wstring m_wide;
+	};
+	bool m_is_compact;
+};
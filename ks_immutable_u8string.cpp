@@ -0,0 +1,66 @@
+﻿/* Copyright 2024 The Kingsoft's modern-string Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "ks_immutable_u8string.h"
+
+ks_immutable_u8string::ks_immutable_u8string(const ks_string_view& str_view, ks_string_util::utf_error_policy policy)
+	: m_str(ks_string_util::sanitize_utf8(ks_immutable_string(str_view), policy)) {
+	m_rune_count = ks_string_util::__u8_rune_count_of_valid(m_str.data(), m_str.length());
+}
+
+ks_immutable_u8string::ks_immutable_u8string(const ks_immutable_string& str, ks_string_util::utf_error_policy policy)
+	: m_str(ks_string_util::sanitize_utf8(str, policy)) {
+	m_rune_count = ks_string_util::__u8_rune_count_of_valid(m_str.data(), m_str.length());
+}
+
+ks_immutable_u8string::ks_immutable_u8string(const ks_wstring_view& wstr_view, ks_string_util::utf_error_policy policy)
+	: m_str(ks_string_util::wstring_to_u8_string(wstr_view, policy)) {
+	m_rune_count = ks_string_util::__u8_rune_count_of_valid(m_str.data(), m_str.length());
+}
+
+char32_t ks_immutable_u8string::rune_at(size_t rune_index) const {
+	size_t pos = ks_string_util::__u8_offset_of_rune(m_str.data(), m_str.length(), rune_index);
+	if (pos == m_str.length())
+		throw std::out_of_range("ks_immutable_u8string::rune_at(rune_index) out-of-range exception");
+	return *rune_iterator(m_str.data() + pos);
+}
+
+ks_immutable_u8string ks_immutable_u8string::substr(size_t rune_pos, size_t rune_count) const {
+	const char* str_data = m_str.data();
+	const size_t str_length = m_str.length();
+	const size_t pos = ks_string_util::__u8_offset_of_rune(str_data, str_length, rune_pos);
+	if (pos == str_length && rune_pos > this->rune_count()) //rune_pos may equal to rune_count()
+		throw std::out_of_range("ks_immutable_u8string::substr(rune_pos) out-of-range exception");
+
+	const size_t end = rune_count == npos ? str_length : pos + ks_string_util::__u8_offset_of_rune(str_data + pos, str_length - pos, rune_count);
+	if (pos == 0 && end == str_length)
+		return *this;
+	//note: the rune count of result is known, it is rune_count unless it is truncated by the end
+	return ks_immutable_u8string(__trusted_mark::v, m_str.substr(pos, end - pos), end != str_length ? rune_count : m_rune_count - rune_pos);
+}
+
+ks_immutable_u8string ks_immutable_u8string::substr(rune_iterator from, rune_iterator to) const {
+	ASSERT(from.base() >= m_str.data() && from.base() <= to.base() && to.base() <= m_str.data() + m_str.length());
+	const size_t pos = from.base() - m_str.data();
+	const size_t count = to.base() - from.base();
+	if (pos == 0 && count == m_str.length())
+		return *this;
+	return ks_immutable_u8string(__trusted_mark::v, m_str.substr(pos, count), ks_string_util::__u8_rune_count_of_valid(from.base(), count));
+}
+
+ks_immutable_wstring ks_immutable_u8string::to_wstring() const {
+	//note: no validation is needed, so the fast converter is used
+	return ks_string_util::wstring_from_u8_chars((const char8_t*)m_str.data(), m_str.length());
+}
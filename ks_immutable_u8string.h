@@ -0,0 +1,135 @@
+﻿/* Copyright 2024 The Kingsoft's modern-string Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include "ks_string_util_convert.h"
+#include <iterator>
+
+//the immutable-string of utf8, which is always well-formed (it is validated or repaired once when constructed),
+//so the rune operations on it are done without any more checking.
+//note: the rune positions/counts are in runes, but length() is in bytes, the same as str().
+class MODERN_STRING_API ks_immutable_u8string {
+public:
+	class rune_iterator {
+	public:
+		using iterator_category = std::bidirectional_iterator_tag;
+		using value_type = char32_t;
+		using difference_type = ptrdiff_t;
+		using pointer = const char32_t*;
+		using reference = char32_t;
+
+		rune_iterator() : m_p(nullptr) {}
+		explicit rune_iterator(const char* p) : m_p((const uint8_t*)p) {}
+
+		char32_t operator*() const {
+			uint ch8 = m_p[0];
+			if (ch8 < 0x80)
+				return (char32_t)(ch8);
+			else if (ch8 < 0xE0)
+				return (char32_t)(((ch8 & 0x1F) << 6) | (uint(m_p[1]) & 0x3F));
+			else if (ch8 < 0xF0)
+				return (char32_t)(((ch8 & 0x0F) << 12) | ((uint(m_p[1]) & 0x3F) << 6) | (uint(m_p[2]) & 0x3F));
+			else
+				return (char32_t)(((ch8 & 0x07) << 18) | ((uint(m_p[1]) & 0x3F) << 12) | ((uint(m_p[2]) & 0x3F) << 6) | (uint(m_p[3]) & 0x3F));
+		}
+
+		rune_iterator& operator++() {
+			uint ch8 = m_p[0];
+			m_p += ch8 < 0x80 ? 1 : ch8 < 0xE0 ? 2 : ch8 < 0xF0 ? 3 : 4;
+			return *this;
+		}
+		rune_iterator& operator--() {
+			do --m_p; while ((m_p[0] & 0xC0) == 0x80);
+			return *this;
+		}
+		rune_iterator operator++(int) { rune_iterator ret = *this; ++(*this); return ret; }
+		rune_iterator operator--(int) { rune_iterator ret = *this; --(*this); return ret; }
+
+		bool operator==(const rune_iterator& right) const { return m_p == right.m_p; }
+		bool operator!=(const rune_iterator& right) const { return m_p != right.m_p; }
+
+		const char* base() const { return (const char*)m_p; } //the byte position of the rune
+
+	private:
+		const uint8_t* m_p;
+	};
+
+	using iterator = rune_iterator;
+	using const_iterator = rune_iterator;
+	using reverse_iterator = std::reverse_iterator<rune_iterator>;
+	using const_reverse_iterator = std::reverse_iterator<rune_iterator>;
+
+	static constexpr size_t npos = size_t(-1);
+
+public:
+	ks_immutable_u8string() = default;
+	explicit ks_immutable_u8string(const ks_string_view& str_view, ks_string_util::utf_error_policy policy = ks_string_util::utf_error_policy::replace);
+	explicit ks_immutable_u8string(const ks_immutable_string& str, ks_string_util::utf_error_policy policy = ks_string_util::utf_error_policy::replace);
+	explicit ks_immutable_u8string(const ks_wstring_view& wstr_view, ks_string_util::utf_error_policy policy = ks_string_util::utf_error_policy::replace);
+
+	ks_immutable_u8string(const ks_immutable_u8string& other) = default;
+	ks_immutable_u8string& operator=(const ks_immutable_u8string& other) = default;
+	ks_immutable_u8string(ks_immutable_u8string&& other) noexcept = default;
+	ks_immutable_u8string& operator=(ks_immutable_u8string&& other) noexcept = default;
+
+public:
+	const ks_immutable_string& str() const { return m_str; }
+	ks_string_view view() const { return m_str.view(); }
+	operator ks_string_view() const { return m_str.view(); }
+
+	const char* data() const { return m_str.data(); }
+	size_t length() const { return m_str.length(); }
+	bool empty() const { return m_str.empty(); }
+
+	rune_iterator begin() const { return rune_iterator(m_str.data()); }
+	rune_iterator end() const { return rune_iterator(m_str.data() + m_str.length()); }
+	reverse_iterator rbegin() const { return reverse_iterator(this->end()); }
+	reverse_iterator rend() const { return reverse_iterator(this->begin()); }
+
+	//the rune count is computed once when constructed, so the const methods never write (thread-safe as the immutable-string)
+	size_t rune_count() const { return m_rune_count; }
+
+	bool is_rune_boundary(size_t pos) const {
+		return pos == m_str.length() || (pos < m_str.length() && (uint8_t(m_str.data()[pos]) & 0xC0) != 0x80);
+	}
+
+	//the rune of rune_index, throw out_of_range if rune_index is out of range
+	char32_t rune_at(size_t rune_index) const;
+
+	//substr by runes (the result shares the buffer with this)
+	ks_immutable_u8string substr(size_t rune_pos, size_t rune_count = npos) const;
+	ks_immutable_u8string substr(rune_iterator from, rune_iterator to) const;
+
+	ks_immutable_wstring to_wstring() const;
+
+	int compare(const ks_immutable_u8string& other) const { return m_str.view().compare(other.view()); }
+	bool operator==(const ks_immutable_u8string& right) const { return m_str.view() == right.view(); }
+	bool operator!=(const ks_immutable_u8string& right) const { return !(*this == right); }
+	bool operator<(const ks_immutable_u8string& right) const { return this->compare(right) < 0; }
+
+private:
+	enum class __trusted_mark { v };
+	ks_immutable_u8string(__trusted_mark, ks_immutable_string&& str, size_t rune_count) : m_str(std::move(str)), m_rune_count(rune_count) {}
+
+private:
+	ks_immutable_string m_str;
+	size_t m_rune_count = 0;
+};
+
+
+inline std::ostream& operator<<(std::ostream& strm, const ks_immutable_u8string& str) {
+	return strm << str.view();
+}
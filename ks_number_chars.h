@@ -0,0 +1,56 @@
+﻿/* Copyright 2024 The Kingsoft's modern-string Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include "base.h"
+
+namespace ks_string_util {
+	// note:
+	// the number is written into dst (not zero-terminated), and the count written is returned.
+	// dst must take max_number_chars chars at least.
+	// the float is written in the shortest form which is parsed back to the same value, by the rule of javascript:
+	// the fixed notation for 1e-6 <= |v| < 1e21 (e.g. 0.001, 123.5), otherwise the exponent notation (e.g. 1e-7, 1.5e+21),
+	// and the special values are written as inf, -inf and nan.
+	constexpr size_t max_number_chars = 32;
+
+	//format int ...
+	MODERN_STRING_API
+	size_t int64_to_chars(int64_t v, char* dst);
+	MODERN_STRING_API
+	size_t int64_to_chars(int64_t v, WCHAR* dst);
+
+	MODERN_STRING_API
+	size_t uint64_to_chars(uint64_t v, char* dst);
+	MODERN_STRING_API
+	size_t uint64_to_chars(uint64_t v, WCHAR* dst);
+
+	MODERN_STRING_API
+	size_t uint64_to_hex_chars(uint64_t v, char* dst, bool is_upper = false); //no 0x prefix, no leading zero
+	MODERN_STRING_API
+	size_t uint64_to_hex_chars(uint64_t v, WCHAR* dst, bool is_upper = false);
+
+	//format float ...
+	MODERN_STRING_API
+	size_t float_to_chars(float v, char* dst);
+	MODERN_STRING_API
+	size_t float_to_chars(float v, WCHAR* dst);
+
+	MODERN_STRING_API
+	size_t double_to_chars(double v, char* dst);
+	MODERN_STRING_API
+	size_t double_to_chars(double v, WCHAR* dst);
+
+}
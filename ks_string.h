@@ -24,6 +24,9 @@ using ks_immutable_string = ks_basic_immutable_string<char>;
 using ks_mutable_wstring = ks_basic_mutable_string<WCHAR>;
 using ks_immutable_wstring = ks_basic_immutable_string<WCHAR>;
 
+using ks_string_edit_batch = ks_basic_string_edit_batch<char>;
+using ks_wstring_edit_batch = ks_basic_string_edit_batch<WCHAR>;
+
 #include "ks_string_util.h"
 
 
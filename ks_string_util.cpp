@@ -15,53 +15,258 @@ limitations under the License.
 
 #include "base.h"
 #include "ks_string_util.h"
+#include "ks_string_util_simd.h"
 
 namespace ks_string_util {
+	//case convert ...
+	//note: only the ascii letters are converted, the chars in [lo, hi] take the 0x20 bit flipped.
+	//the wide chars >= 0x8000 are negative in the signed compare, so they are never in the range, as the non-ascii chars.
+
+	template <class ELEM>
+	static size_t __find_case_source_scalar(const ELEM* p, size_t pos, size_t len, ELEM lo, ELEM hi) {
+		while (pos < len && !(p[pos] >= lo && p[pos] <= hi))
+			++pos;
+		return pos;
+	}
+
+	template <class ELEM>
+	static void __convert_case_scalar(const ELEM* src, size_t pos, size_t len, ELEM* dst, ELEM lo, ELEM hi) {
+		for (; pos < len; ++pos)
+			dst[pos] = src[pos] >= lo && src[pos] <= hi ? ELEM(src[pos] ^ 0x20) : src[pos];
+	}
+
+#if _KS_SIMD_SSE2
+	static inline __m128i __in_case_range_sse2(__m128i v, char lo, char hi) {
+		return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(char(lo - 1))), _mm_cmplt_epi8(v, _mm_set1_epi8(char(hi + 1))));
+	}
+	static inline __m128i __in_case_range_sse2(__m128i v, WCHAR lo, WCHAR hi) {
+		return _mm_and_si128(_mm_cmpgt_epi16(v, _mm_set1_epi16(short(lo - 1))), _mm_cmplt_epi16(v, _mm_set1_epi16(short(hi + 1))));
+	}
+
+	template <class ELEM>
+	static size_t __find_case_source_sse2(const ELEM* p, size_t len, ELEM lo, ELEM hi) {
+		constexpr size_t step = 16 / sizeof(ELEM);
+		size_t pos = 0;
+		for (; pos + step <= len; pos += step) {
+			const uint32_t mask = (uint32_t)_mm_movemask_epi8(__in_case_range_sse2(_mm_loadu_si128((const __m128i*)(p + pos)), lo, hi));
+			if (mask != 0)
+				return pos + __simd::ctz32(mask) / sizeof(ELEM);
+		}
+		return __find_case_source_scalar(p, pos, len, lo, hi);
+	}
+
+	template <class ELEM>
+	static void __convert_case_sse2(const ELEM* src, size_t len, ELEM* dst, ELEM lo, ELEM hi) {
+		constexpr size_t step = 16 / sizeof(ELEM);
+		const __m128i v_flip = sizeof(ELEM) == 1 ? _mm_set1_epi8(0x20) : _mm_set1_epi16(0x20);
+		size_t pos = 0;
+		for (; pos + step <= len; pos += step) {
+			const __m128i v = _mm_loadu_si128((const __m128i*)(src + pos));
+			_mm_storeu_si128((__m128i*)(dst + pos), _mm_xor_si128(v, _mm_and_si128(__in_case_range_sse2(v, lo, hi), v_flip)));
+		}
+		__convert_case_scalar(src, pos, len, dst, lo, hi);
+	}
+#endif
+
+#if _KS_SIMD_AVX2
+	_KS_TARGET_AVX2
+	static inline __m256i __in_case_range_avx2(__m256i v, char lo, char hi) {
+		return _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8(char(lo - 1))), _mm256_cmpgt_epi8(_mm256_set1_epi8(char(hi + 1)), v));
+	}
+	_KS_TARGET_AVX2
+	static inline __m256i __in_case_range_avx2(__m256i v, WCHAR lo, WCHAR hi) {
+		return _mm256_and_si256(_mm256_cmpgt_epi16(v, _mm256_set1_epi16(short(lo - 1))), _mm256_cmpgt_epi16(_mm256_set1_epi16(short(hi + 1)), v));
+	}
+
+	template <class ELEM>
+	_KS_TARGET_AVX2
+	static size_t __find_case_source_avx2(const ELEM* p, size_t len, ELEM lo, ELEM hi) {
+		constexpr size_t step = 32 / sizeof(ELEM);
+		size_t pos = 0;
+		for (; pos + step <= len; pos += step) {
+			const uint32_t mask = (uint32_t)_mm256_movemask_epi8(__in_case_range_avx2(_mm256_loadu_si256((const __m256i*)(p + pos)), lo, hi));
+			if (mask != 0) {
+				_mm256_zeroupper();
+				return pos + __simd::ctz32(mask) / sizeof(ELEM);
+			}
+		}
+		_mm256_zeroupper();
+		return __find_case_source_scalar(p, pos, len, lo, hi);
+	}
+
+	template <class ELEM>
+	_KS_TARGET_AVX2
+	static void __convert_case_avx2(const ELEM* src, size_t len, ELEM* dst, ELEM lo, ELEM hi) {
+		constexpr size_t step = 32 / sizeof(ELEM);
+		const __m256i v_flip = sizeof(ELEM) == 1 ? _mm256_set1_epi8(0x20) : _mm256_set1_epi16(0x20);
+		size_t pos = 0;
+		for (; pos + step <= len; pos += step) {
+			const __m256i v = _mm256_loadu_si256((const __m256i*)(src + pos));
+			_mm256_storeu_si256((__m256i*)(dst + pos), _mm256_xor_si256(v, _mm256_and_si256(__in_case_range_avx2(v, lo, hi), v_flip)));
+		}
+		_mm256_zeroupper();
+		__convert_case_scalar(src, pos, len, dst, lo, hi);
+	}
+#endif
+
+	template <class ELEM>
+	static size_t __find_case_source(const ELEM* p, size_t len, ELEM lo, ELEM hi) {
+#if _KS_SIMD_AVX2
+		if (__simd::cpu_has_avx2())
+			return __find_case_source_avx2(p, len, lo, hi);
+#endif
+#if _KS_SIMD_SSE2
+		return __find_case_source_sse2(p, len, lo, hi);
+#else
+		return __find_case_source_scalar(p, 0, len, lo, hi);
+#endif
+	}
+
+	template <class ELEM>
+	static void __convert_case(const ELEM* src, size_t len, ELEM* dst, ELEM lo, ELEM hi) {
+#if _KS_SIMD_AVX2
+		if (__simd::cpu_has_avx2())
+			return __convert_case_avx2(src, len, dst, lo, hi);
+#endif
+#if _KS_SIMD_SSE2
+		return __convert_case_sse2(src, len, dst, lo, hi);
+#else
+		return __convert_case_scalar(src, 0, len, dst, lo, hi);
+#endif
+	}
+
+	MODERN_STRING_API
+	size_t __find_spec_case_source(const char* p, size_t len, bool to_lower_or_upper) {
+		return to_lower_or_upper ? __find_case_source<char>(p, len, 'A', 'Z') : __find_case_source<char>(p, len, 'a', 'z');
+	}
+
+	MODERN_STRING_API
+	size_t __find_spec_case_source(const WCHAR* p, size_t len, bool to_lower_or_upper) {
+		return to_lower_or_upper ? __find_case_source<WCHAR>(p, len, 'A', 'Z') : __find_case_source<WCHAR>(p, len, 'a', 'z');
+	}
+
+	MODERN_STRING_API
+	void __to_spec_case_chars(const char* src, size_t len, char* dst, bool to_lower_or_upper) {
+		return to_lower_or_upper ? __convert_case<char>(src, len, dst, 'A', 'Z') : __convert_case<char>(src, len, dst, 'a', 'z');
+	}
+
+	MODERN_STRING_API
+	void __to_spec_case_chars(const WCHAR* src, size_t len, WCHAR* dst, bool to_lower_or_upper) {
+		return to_lower_or_upper ? __convert_case<WCHAR>(src, len, dst, 'A', 'Z') : __convert_case<WCHAR>(src, len, dst, 'a', 'z');
+	}
+
+
 	//icase compare ...
-	MODERN_STRING_INLINE_API
-	template <class ELEM> 
-	static int __do_icase_compare(const ks_basic_string_view<ELEM>& left, const ks_basic_string_view<ELEM>& right) {
-		const ELEM* left_data = left.data();
-		const ELEM* right_data = right.data();
-		size_t left_length = left.length();
-		size_t right_length = right.length();
-
-		int diff = 0;
-		if (left_data != right_data) {
-			size_t min_length = std::min(left_length, right_length);
-			for (size_t i = 0; i < min_length; ++i) {
-				ELEM left_ch = left_data[i];
-				ELEM right_ch = right_data[i];
-				if (left_ch == right_ch)
-					continue;
-
-				if (left_ch >= 'A' && left_ch <= 'Z') {
-					left_ch = 'a' + (left_ch - 'A');
-					if (left_ch == right_ch)
-						continue;
-				}
-				else if (right_ch >= 'A' && right_ch <= 'Z') {
-					right_ch = 'a' + (right_ch - 'A');
-					if (left_ch == right_ch)
-						continue;
-				}
-
-				diff = left_ch < right_ch ? -1 : +1;
-				break;
+	//note: the ascii letters of both sides are lowered, and the chars are compared as unsigned, like the case-sensitive compare.
+
+	template <class ELEM>
+	static inline ELEM __fold_case(ELEM ch) {
+		return ch >= 'A' && ch <= 'Z' ? ELEM(ch | 0x20) : ch;
+	}
+
+	//return the pos of the first mismatch in [pos, len), or len
+	template <class ELEM>
+	static size_t __icase_mismatch_scalar(const ELEM* left, const ELEM* right, size_t pos, size_t len) {
+		while (pos < len && __fold_case(left[pos]) == __fold_case(right[pos]))
+			++pos;
+		return pos;
+	}
+
+#if _KS_SIMD_SSE2
+	template <class ELEM>
+	static inline __m128i __fold_case_sse2(__m128i v) {
+		const __m128i v_flip = sizeof(ELEM) == 1 ? _mm_set1_epi8(0x20) : _mm_set1_epi16(0x20);
+		return _mm_or_si128(v, _mm_and_si128(__in_case_range_sse2(v, ELEM('A'), ELEM('Z')), v_flip));
+	}
+
+	template <class ELEM>
+	static inline uint32_t __icase_match_mask_sse2(const ELEM* left, const ELEM* right) {
+		const __m128i v_left = _mm_loadu_si128((const __m128i*)left);
+		const __m128i v_right = _mm_loadu_si128((const __m128i*)right);
+		return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(__fold_case_sse2<ELEM>(v_left), __fold_case_sse2<ELEM>(v_right)));
+	}
+
+	template <class ELEM>
+	static size_t __icase_mismatch_sse2(const ELEM* left, const ELEM* right, size_t len) {
+		constexpr size_t step = 16 / sizeof(ELEM);
+		if (len < step)
+			return __icase_mismatch_scalar(left, right, 0, len);
+
+		//the last block overlaps the previous one, as the chars before pos are matched already
+		for (size_t pos = 0; pos < len; pos += step) {
+			pos = (std::min)(pos, len - step);
+			const uint32_t mask = __icase_match_mask_sse2(left + pos, right + pos);
+			if (mask != 0xFFFF)
+				return pos + __simd::ctz32(~mask) / sizeof(ELEM);
+		}
+		return len;
+	}
+#endif
+
+#if _KS_SIMD_AVX2
+	template <class ELEM>
+	_KS_TARGET_AVX2
+	static inline __m256i __fold_case_avx2(__m256i v) {
+		const __m256i v_flip = sizeof(ELEM) == 1 ? _mm256_set1_epi8(0x20) : _mm256_set1_epi16(0x20);
+		return _mm256_or_si256(v, _mm256_and_si256(__in_case_range_avx2(v, ELEM('A'), ELEM('Z')), v_flip));
+	}
+
+	//len must be >= 32 bytes
+	template <class ELEM>
+	_KS_TARGET_AVX2
+	static size_t __icase_mismatch_avx2(const ELEM* left, const ELEM* right, size_t len) {
+		constexpr size_t step = 32 / sizeof(ELEM);
+		ASSERT(len >= step);
+
+		//the last block overlaps the previous one, as the chars before pos are matched already
+		for (size_t pos = 0; pos < len; pos += step) {
+			pos = (std::min)(pos, len - step);
+			const __m256i v_left = _mm256_loadu_si256((const __m256i*)(left + pos));
+			const __m256i v_right = _mm256_loadu_si256((const __m256i*)(right + pos));
+			const uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(__fold_case_avx2<ELEM>(v_left), __fold_case_avx2<ELEM>(v_right)));
+			if (mask != 0xFFFFFFFF) {
+				_mm256_zeroupper();
+				return pos + __simd::ctz32(~mask) / sizeof(ELEM);
 			}
 		}
+		_mm256_zeroupper();
+		return len;
+	}
+#endif
+
+	template <class ELEM>
+	static size_t __icase_mismatch(const ELEM* left, const ELEM* right, size_t len) {
+		if (left == right)
+			return len;
+#if _KS_SIMD_AVX2
+		if (len >= 32 / sizeof(ELEM) && __simd::cpu_has_avx2())
+			return __icase_mismatch_avx2(left, right, len);
+#endif
+#if _KS_SIMD_SSE2
+		return __icase_mismatch_sse2(left, right, len);
+#else
+		return __icase_mismatch_scalar(left, right, 0, len);
+#endif
+	}
 
-		if (diff == 0 && left_length != right_length)
-			diff = left_length < right_length ? -1 : +1;
+	template <class ELEM>
+	static int __do_icase_compare(const ks_basic_string_view<ELEM>& left, const ks_basic_string_view<ELEM>& right) {
+		using UELEM = std::make_unsigned_t<ELEM>;
+		const size_t left_length = left.length();
+		const size_t right_length = right.length();
+		const size_t min_length = std::min(left_length, right_length);
 
-		return diff;
+		const size_t pos = __icase_mismatch(left.data(), right.data(), min_length);
+		if (pos < min_length)
+			return UELEM(__fold_case(left.data()[pos])) < UELEM(__fold_case(right.data()[pos])) ? -1 : +1;
+
+		return left_length == right_length ? 0 : left_length < right_length ? -1 : +1;
 	}
 
-	MODERN_STRING_INLINE_API
-	template <class ELEM> 
+	template <class ELEM>
 	static bool __do_icase_equals(const ks_basic_string_view<ELEM>& left, const ks_basic_string_view<ELEM>& right) {
 		return left.length() == right.length()
-			&& __do_icase_compare<ELEM>(left, right) == 0;
+			&& __icase_mismatch(left.data(), right.data(), left.length()) == left.length();
 	}
 
 	MODERN_STRING_API
@@ -74,4 +279,15 @@ namespace ks_string_util {
 		return __do_icase_equals<WCHAR>(left, right);
 	}
 
+	MODERN_STRING_API
+	int icase_compare(const ks_string_view& left, const ks_string_view& right) {
+		return __do_icase_compare<char>(left, right);
+	}
+
+	MODERN_STRING_API
+	int icase_compare(const ks_wstring_view& left, const ks_wstring_view& right) {
+		return __do_icase_compare<WCHAR>(left, right);
+	}
+
 }
+
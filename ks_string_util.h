@@ -69,10 +69,28 @@ namespace ks_string_util {
 	bool icase_equals(const ks_string_view& left, const ks_string_view& right);
 	MODERN_STRING_API
 	bool icase_equals(const ks_wstring_view& left, const ks_wstring_view& right);
+	MODERN_STRING_API
+	int icase_compare(const ks_string_view& left, const ks_string_view& right); //<0, 0 or >0, the ascii letters of both sides are lowered
+	MODERN_STRING_API
+	int icase_compare(const ks_wstring_view& left, const ks_wstring_view& right);
+
+	//icase hash and equal-to, for the unordered containers without the lowered keys,
+	//e.g. std::unordered_map<ks_immutable_string, T, icase_hash, icase_equal_to>
+	struct icase_hash {
+		size_t operator()(const ks_string_view& str_view) const noexcept;
+		size_t operator()(const ks_wstring_view& str_view) const noexcept;
+	};
+	struct icase_equal_to {
+		bool operator()(const ks_string_view& left, const ks_string_view& right) const { return icase_equals(left, right); }
+		bool operator()(const ks_wstring_view& left, const ks_wstring_view& right) const { return icase_equals(left, right); }
+	};
 
 }
 
+#include "ks_number_chars.h"
 #include "ks_string_util.inl"
 
 #include "ks_string_util_parse.h"
 #include "ks_string_util_convert.h"
+#include "ks_string_util_formatter.h"
+#include "ks_string_util_codec.h"
@@ -66,18 +66,61 @@ namespace ks_string_util {
 	}
 
 	//stringize ...
+	//note: the integers and floats are formatted directly into a small buffer (the float takes the shortest round-trip form),
+	//the others go through std::to_string
 	template <class T>
-	ks_immutable_string to_string(const T& v) {
+	using __number_kind_of = std::integral_constant<int,
+		std::is_integral_v<T> ? (std::is_signed_v<T> ? 1 : 2)
+		: std::is_same_v<T, float> ? 3
+		: std::is_same_v<T, double> ? 4
+		: 0>;
+
+	template <class T>
+	ks_immutable_string __std_to_basic_string(const T& v, char*) {
 		return ks_immutable_string(std::to_string(v));
 	}
-
 	template <class T>
-	ks_immutable_wstring to_wstring(const T& v) {
+	ks_immutable_wstring __std_to_basic_string(const T& v, WCHAR*) {
 		extern ks_immutable_wstring wstring_from_native_wide_chars(const wchar_t* p, size_t len);
 		std::wstring std_wstr = std::to_wstring(v);
 		return wstring_from_native_wide_chars(std_wstr.data(), std_wstr.length());
 	}
 
+	template <class ELEM, class T>
+	ks_basic_immutable_string<ELEM> __to_basic_string(const T& v, std::integral_constant<int, 0>) {
+		return __std_to_basic_string(v, (ELEM*)nullptr);
+	}
+	template <class ELEM, class T>
+	ks_basic_immutable_string<ELEM> __to_basic_string(const T& v, std::integral_constant<int, 1>) {
+		ELEM buf[max_number_chars];
+		return ks_basic_immutable_string<ELEM>(buf, int64_to_chars((int64_t)v, buf));
+	}
+	template <class ELEM, class T>
+	ks_basic_immutable_string<ELEM> __to_basic_string(const T& v, std::integral_constant<int, 2>) {
+		ELEM buf[max_number_chars];
+		return ks_basic_immutable_string<ELEM>(buf, uint64_to_chars((uint64_t)v, buf));
+	}
+	template <class ELEM, class T>
+	ks_basic_immutable_string<ELEM> __to_basic_string(const T& v, std::integral_constant<int, 3>) {
+		ELEM buf[max_number_chars];
+		return ks_basic_immutable_string<ELEM>(buf, float_to_chars(v, buf));
+	}
+	template <class ELEM, class T>
+	ks_basic_immutable_string<ELEM> __to_basic_string(const T& v, std::integral_constant<int, 4>) {
+		ELEM buf[max_number_chars];
+		return ks_basic_immutable_string<ELEM>(buf, double_to_chars(v, buf));
+	}
+
+	template <class T>
+	ks_immutable_string to_string(const T& v) {
+		return __to_basic_string<char>(v, __number_kind_of<T>());
+	}
+
+	template <class T>
+	ks_immutable_wstring to_wstring(const T& v) {
+		return __to_basic_string<WCHAR>(v, __number_kind_of<T>());
+	}
+
 	//stringize (specialization for bool) ...
 	template <> inline 
 	ks_immutable_string to_string<bool>(const bool& v) {
@@ -151,34 +194,54 @@ namespace ks_string_util {
 	}
 
 	//concat
+	template <class ELEM, class T1>
+	ks_basic_immutable_string<ELEM> __do_concat_pick(size_t index, const T1& s1) {
+		ASSERT(index == 0);
+		return ks_basic_immutable_string<ELEM>(s1);
+	}
+
+	template <class ELEM, class T1, class T2, class... Ts>
+	ks_basic_immutable_string<ELEM> __do_concat_pick(size_t index, const T1& s1, const T2& s2, const Ts&... sx) {
+		return index == 0 ? ks_basic_immutable_string<ELEM>(s1) : __do_concat_pick<ELEM>(index - 1, s2, sx...);
+	}
+
 	template <class ELEM, class T1, class... Ts>
 	ks_basic_immutable_string<ELEM> __do_concat_va(const T1& s1, const Ts&... sx) {
 		if (sizeof...(sx) == 0)
 			return s1;
-		if (__is_string_empty(s1))
-			return __do_concat_va<ELEM>(sx...);
 
-		ks_basic_string_view<ELEM> str_view_arr[] = { ks_basic_string_view<ELEM>{}, __to_string_view(sx)... };
-		const size_t str_view_arr_size = 1 + sizeof...(sx);
+		//note: the args are expanded into a fixed-size view array on stack, so each length is measured only once
+		const ks_basic_string_view<ELEM> str_view_arr[] = { __to_string_view(s1), __to_string_view(sx)... };
+		constexpr size_t str_view_arr_size = 1 + sizeof...(sx);
 
-		bool is_sx_empty = true;
-		for (size_t i = i; i < str_view_arr_size; ++i) {
-			if (str_view_arr[i].empty()) {
-				is_sx_empty = false;
-				break;
+		size_t total_len = 0;
+		size_t nonempty_count = 0;
+		size_t nonempty_index = 0;
+		for (size_t i = 0; i < str_view_arr_size; ++i) {
+			if (!str_view_arr[i].empty()) {
+				total_len += str_view_arr[i].length();
+				nonempty_count += 1;
+				nonempty_index = i;
 			}
 		}
 
-		if (is_sx_empty)
-			return s1;
+		if (nonempty_count == 0)
+			return ks_basic_immutable_string<ELEM>();
+		if (nonempty_count == 1)
+			return __do_concat_pick<ELEM>(nonempty_index, s1, sx...); //share the only non-empty arg if it is a xmutable-string
 
-		str_view_arr[0] = __to_string_view(s1);
-		return __do_join<ELEM>(str_view_arr, str_view_arr + str_view_arr_size, ks_basic_string_view<ELEM>(), ks_basic_string_view<ELEM>(), ks_basic_string_view<ELEM>());
-	}
+		//write into the sso-buffer or one heap-buffer directly
+		ks_basic_mutable_string<ELEM> mut_ret;
+		ELEM* ret_data = mut_ret.__begin_exclusive_writing(total_len);
+		ELEM* ret_data_p = ret_data;
+		for (size_t i = 0; i < str_view_arr_size; ++i) {
+			std::copy_n(str_view_arr[i].data(), str_view_arr[i].length(), ret_data_p);
+			ret_data_p += str_view_arr[i].length();
+		}
 
-	template <class ELEM>
-	ks_basic_immutable_string<ELEM> __do_concat_va() {
-		return ks_basic_immutable_string<ELEM>();
+		ASSERT(ret_data_p == ret_data + total_len);
+		mut_ret.__end_exclusive_writing(ret_data, total_len);
+		return std::move(mut_ret);
 	}
 
 	template <class T1, class... Ts, class _ /*= std::enable_if_t<std::is_convertible_v<T1, ks_string_view>>*/>
@@ -191,25 +254,33 @@ namespace ks_string_util {
 	}
 
 	//case convert ...
+	//the simd kernels, find the first char to convert (or return len), and convert the chars into dst
+	MODERN_STRING_API
+	size_t __find_spec_case_source(const char* p, size_t len, bool to_lower_or_upper);
+	MODERN_STRING_API
+	size_t __find_spec_case_source(const WCHAR* p, size_t len, bool to_lower_or_upper);
+	MODERN_STRING_API
+	void __to_spec_case_chars(const char* src, size_t len, char* dst, bool to_lower_or_upper);
+	MODERN_STRING_API
+	void __to_spec_case_chars(const WCHAR* src, size_t len, WCHAR* dst, bool to_lower_or_upper);
+
 	template <class ELEM, class STR_TYPE>
 	ks_basic_immutable_string<ELEM> __to_spec_case(STR_TYPE&& str, bool to_lower_or_upper) {
-		ks_basic_mutable_string<ELEM> mut_ret(std::forward<STR_TYPE>(str));
-
-		size_t pos = 0;
-		size_t length = mut_ret.length();
-		while (pos < length) {
-			pos = to_lower_or_upper
-				? std::find_if(mut_ret.cbegin() + pos, mut_ret.cend(), [](ELEM ch) -> bool { return ch >= 'A' && ch <= 'Z'; }) - mut_ret.cbegin()
-				: std::find_if(mut_ret.cbegin() + pos, mut_ret.cend(), [](ELEM ch) -> bool { return ch >= 'a' && ch <= 'z'; }) - mut_ret.cbegin();
-			if (pos < length) {
-				mut_ret.set_at(pos, to_lower_or_upper ? 'a' + (mut_ret[pos] - 'A') : 'A' + (mut_ret[pos] - 'a'));
-				++pos;
-			}
-			else {
-				break;
-			}
-		}
+		const ks_basic_string_view<ELEM> str_view = str;
+		const ELEM* const str_data = str_view.data();
+		const size_t length = str_view.length();
 
+		//note: the probe goes first, so the unchanged string is returned as is (shared if it is a xmutable-string)
+		const size_t first_pos = __find_spec_case_source(str_data, length, to_lower_or_upper);
+		if (first_pos == length)
+			return ks_basic_immutable_string<ELEM>(std::forward<STR_TYPE>(str));
+
+		ks_basic_mutable_string<ELEM> mut_ret;
+		ELEM* ret_data = mut_ret.__begin_exclusive_writing(length);
+		std::copy_n(str_data, first_pos, ret_data);
+		__to_spec_case_chars(str_data + first_pos, length - first_pos, ret_data + first_pos, to_lower_or_upper);
+
+		mut_ret.__end_exclusive_writing(ret_data, length);
 		return std::move(mut_ret);
 	}
 
@@ -231,4 +302,30 @@ namespace ks_string_util {
 		return __to_spec_case<WCHAR>(std::forward<STR_TYPE>(str), false);
 	}
 
+	//icase hash ...
+	//note: the same fnv-1a as std::hash<ks_basic_string_view>, with the ascii letters lowered
+	template <class ELEM>
+	inline size_t __do_icase_hash(const ks_basic_string_view<ELEM>& str_view) noexcept {
+		constexpr size_t _FNV_offset_basis = sizeof(size_t) == 8 ? (size_t)14695981039346656037ULL : (size_t)2166136261UL;
+		constexpr size_t _FNV_prime = sizeof(size_t) == 8 ? (size_t)1099511628211ULL : (size_t)16777619UL;
+
+		size_t hash_val = _FNV_offset_basis;
+		const ELEM* data = str_view.data();
+		const ELEM* data_end = data + str_view.length();
+		for (; data < data_end; ++data) {
+			const ELEM ch = *data;
+			hash_val ^= static_cast<size_t>(ch >= 'A' && ch <= 'Z' ? ELEM(ch | 0x20) : ch);
+			hash_val *= _FNV_prime;
+		}
+
+		return hash_val;
+	}
+
+	inline size_t icase_hash::operator()(const ks_string_view& str_view) const noexcept {
+		return __do_icase_hash<char>(str_view);
+	}
+	inline size_t icase_hash::operator()(const ks_wstring_view& str_view) const noexcept {
+		return __do_icase_hash<WCHAR>(str_view);
+	}
+
 }
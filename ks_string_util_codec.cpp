@@ -0,0 +1,553 @@
+﻿/* Copyright 2024 The Kingsoft's modern-string Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "ks_string_util_codec.h"
+#include "ks_string_util_simd.h"
+
+namespace ks_string_util {
+	static const char s_hex_lower_chars[] = "0123456789abcdef";
+	static const char s_hex_upper_chars[] = "0123456789ABCDEF";
+
+	static inline int __hex_value_of(uint8_t ch) {
+		const uint8_t ch_lower = ch | 0x20;
+		return ch >= '0' && ch <= '9' ? ch - '0'
+			: ch_lower >= 'a' && ch_lower <= 'f' ? ch_lower - 'a' + 10
+			: -1;
+	}
+
+#if _KS_SIMD_SSE2
+	//the hex value of each char, and the mask of the valid ones
+	static inline __m128i __hex_values_sse2(__m128i v, __m128i* valid) {
+		const __m128i v_lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+		const __m128i is_digit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1)));
+		const __m128i is_alpha = _mm_and_si128(_mm_cmpgt_epi8(v_lower, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(v_lower, _mm_set1_epi8('f' + 1)));
+		*valid = _mm_or_si128(is_digit, is_alpha);
+		return _mm_or_si128(
+			_mm_and_si128(is_digit, _mm_sub_epi8(v, _mm_set1_epi8('0'))),
+			_mm_and_si128(is_alpha, _mm_sub_epi8(v_lower, _mm_set1_epi8('a' - 10))));
+	}
+#endif
+
+
+	//hex kernels
+
+	static char* __hex_encode_scalar(const uint8_t* p, const uint8_t* end, char* dst, bool is_upper) {
+		const char* const hex_chars = is_upper ? s_hex_upper_chars : s_hex_lower_chars;
+		for (; p < end; ++p) {
+			*dst++ = hex_chars[*p >> 4];
+			*dst++ = hex_chars[*p & 0x0F];
+		}
+		return dst;
+	}
+
+	//return the end, or the first invalid char, (end - p) must be even
+	static const uint8_t* __hex_decode_scalar(const uint8_t* p, const uint8_t* end, uint8_t* dst) {
+		for (; p < end; p += 2) {
+			const int hi = __hex_value_of(p[0]);
+			const int lo = __hex_value_of(p[1]);
+			if (hi < 0)
+				return p;
+			if (lo < 0)
+				return p + 1;
+			*dst++ = uint8_t(hi << 4 | lo);
+		}
+		return p;
+	}
+
+#if _KS_SIMD_SSE2
+	static inline __m128i __hex_chars_of_nibbles_sse2(__m128i nibbles, __m128i alpha_offset) {
+		const __m128i is_alpha = _mm_cmpgt_epi8(nibbles, _mm_set1_epi8(9));
+		return _mm_add_epi8(_mm_add_epi8(nibbles, _mm_set1_epi8('0')), _mm_and_si128(is_alpha, alpha_offset));
+	}
+
+	static char* __hex_encode_sse2(const uint8_t* p, const uint8_t* end, char* dst, bool is_upper) {
+		const __m128i v_0F = _mm_set1_epi8(0x0F);
+		const __m128i alpha_offset = _mm_set1_epi8(is_upper ? 'A' - '0' - 10 : 'a' - '0' - 10);
+		for (; end - p >= 16; p += 16, dst += 32) {
+			const __m128i v = _mm_loadu_si128((const __m128i*)p);
+			const __m128i hi = __hex_chars_of_nibbles_sse2(_mm_and_si128(_mm_srli_epi16(v, 4), v_0F), alpha_offset);
+			const __m128i lo = __hex_chars_of_nibbles_sse2(_mm_and_si128(v, v_0F), alpha_offset);
+			_mm_storeu_si128((__m128i*)dst, _mm_unpacklo_epi8(hi, lo));
+			_mm_storeu_si128((__m128i*)(dst + 16), _mm_unpackhi_epi8(hi, lo));
+		}
+		return __hex_encode_scalar(p, end, dst, is_upper);
+	}
+
+	//the pairs of hex values (in the 16-bit words) => bytes
+	static inline __m128i __hex_pairs_to_bytes_sse2(__m128i values) {
+		return _mm_or_si128(_mm_slli_epi16(_mm_and_si128(values, _mm_set1_epi16(0x00FF)), 4), _mm_srli_epi16(values, 8));
+	}
+
+	static const uint8_t* __hex_decode_sse2(const uint8_t* p, const uint8_t* end, uint8_t* dst) {
+		for (; end - p >= 32; p += 32, dst += 16) {
+			__m128i valid0, valid1;
+			const __m128i values0 = __hex_values_sse2(_mm_loadu_si128((const __m128i*)p), &valid0);
+			const __m128i values1 = __hex_values_sse2(_mm_loadu_si128((const __m128i*)(p + 16)), &valid1);
+			if (_mm_movemask_epi8(_mm_and_si128(valid0, valid1)) != 0xFFFF)
+				break; //the scalar step finds the invalid char
+			_mm_storeu_si128((__m128i*)dst, _mm_packus_epi16(__hex_pairs_to_bytes_sse2(values0), __hex_pairs_to_bytes_sse2(values1)));
+		}
+		return __hex_decode_scalar(p, end, dst);
+	}
+#endif
+
+	static char* __hex_encode(const uint8_t* p, const uint8_t* end, char* dst, bool is_upper) {
+#if _KS_SIMD_SSE2
+		return __hex_encode_sse2(p, end, dst, is_upper);
+#else
+		return __hex_encode_scalar(p, end, dst, is_upper);
+#endif
+	}
+
+	static const uint8_t* __hex_decode(const uint8_t* p, const uint8_t* end, uint8_t* dst) {
+#if _KS_SIMD_SSE2
+		return __hex_decode_sse2(p, end, dst);
+#else
+		return __hex_decode_scalar(p, end, dst);
+#endif
+	}
+
+
+	//base64 kernels
+
+	static const char s_base64_chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	static const char s_base64_url_chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+	struct __base64_value_table {
+		int8_t values[256];
+
+		explicit __base64_value_table(const char* alphabet) {
+			std::fill_n(values, 256, int8_t(-1));
+			for (int i = 0; i < 64; ++i)
+				values[(uint8_t)alphabet[i]] = int8_t(i);
+		}
+	};
+
+	static const __base64_value_table s_base64_value_table(s_base64_chars);
+	static const __base64_value_table s_base64_url_value_table(s_base64_url_chars);
+
+	static inline size_t __base64_encoded_length(size_t len, bool is_padded) {
+		return is_padded ? (len + 2) / 3 * 4 : len / 3 * 4 + (len % 3 == 0 ? 0 : len % 3 + 1);
+	}
+
+	static char* __base64_encode_scalar(const uint8_t* p, const uint8_t* end, char* dst, const char* alphabet, bool is_padded) {
+		for (; end - p >= 3; p += 3, dst += 4) {
+			const uint32_t v = uint32_t(p[0]) << 16 | uint32_t(p[1]) << 8 | p[2];
+			dst[0] = alphabet[v >> 18];
+			dst[1] = alphabet[(v >> 12) & 0x3F];
+			dst[2] = alphabet[(v >> 6) & 0x3F];
+			dst[3] = alphabet[v & 0x3F];
+		}
+
+		if (p != end) {
+			const bool has_2nd = end - p == 2;
+			const uint32_t v = uint32_t(p[0]) << 16 | (has_2nd ? uint32_t(p[1]) << 8 : 0);
+			*dst++ = alphabet[v >> 18];
+			*dst++ = alphabet[(v >> 12) & 0x3F];
+			if (has_2nd)
+				*dst++ = alphabet[(v >> 6) & 0x3F];
+			else if (is_padded)
+				*dst++ = '=';
+			if (is_padded)
+				*dst++ = '=';
+		}
+		return dst;
+	}
+
+	//decode the full quads, return the end, or the first invalid char
+	static const uint8_t* __base64_decode_scalar(const uint8_t* p, const uint8_t* end, uint8_t* dst, const int8_t* values) {
+		for (; end - p >= 4; p += 4, dst += 3) {
+			const int a = values[p[0]], b = values[p[1]], c = values[p[2]], d = values[p[3]];
+			if ((a | b | c | d) < 0) {
+				for (int i = 0; ; ++i) {
+					if (values[p[i]] < 0)
+						return p + i;
+				}
+			}
+
+			const uint32_t v = uint32_t(a) << 18 | uint32_t(b) << 12 | uint32_t(c) << 6 | uint32_t(d);
+			dst[0] = uint8_t(v >> 16);
+			dst[1] = uint8_t(v >> 8);
+			dst[2] = uint8_t(v);
+		}
+		return p;
+	}
+
+#if _KS_SIMD_AVX2
+	//note: the kernels follow Muła and Lemire's base64 algorithm,
+	//the 6-bit fields are split by the multiplies, and mapped to the alphabet by a 16-entry lookup of the offsets.
+	_KS_TARGET_AVX2
+	static char* __base64_encode_avx2(const uint8_t* p, const uint8_t* end, char* dst, bool is_url_safe, bool is_padded) {
+		const char ch62 = is_url_safe ? '-' : '+';
+		const char ch63 = is_url_safe ? '_' : '/';
+		const __m256i v_shuffle = _mm256_setr_epi8(
+			1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+			1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+		const __m256i v_offsets = _mm256_setr_epi8(
+			'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+			'0' - 52, '0' - 52, '0' - 52, char(ch62 - 62), char(ch63 - 63), 'A', 0, 0,
+			'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+			'0' - 52, '0' - 52, '0' - 52, char(ch62 - 62), char(ch63 - 63), 'A', 0, 0);
+
+		//each lane takes 12 bytes by a 16-byte load, so 4 more bytes must be readable
+		for (; end - p >= 28; p += 24, dst += 32) {
+			__m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)p)), _mm_loadu_si128((const __m128i*)(p + 12)), 1);
+			v = _mm256_shuffle_epi8(v, v_shuffle);
+
+			const __m256i t0 = _mm256_mulhi_epu16(_mm256_and_si256(v, _mm256_set1_epi32(0x0FC0FC00)), _mm256_set1_epi32(0x04000040));
+			const __m256i t1 = _mm256_mullo_epi16(_mm256_and_si256(v, _mm256_set1_epi32(0x003F03F0)), _mm256_set1_epi32(0x01000010));
+			const __m256i indices = _mm256_or_si256(t0, t1);
+
+			//0..25 => 13, 26..51 => 0, 52..61 => 1..10, 62 => 11, 63 => 12
+			__m256i offset_index = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+			offset_index = _mm256_or_si256(offset_index, _mm256_and_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices), _mm256_set1_epi8(13)));
+			const __m256i chars = _mm256_add_epi8(indices, _mm256_shuffle_epi8(v_offsets, offset_index));
+			_mm256_storeu_si256((__m256i*)dst, chars);
+		}
+
+		_mm256_zeroupper();
+		return __base64_encode_scalar(p, end, dst, is_url_safe ? s_base64_url_chars : s_base64_chars, is_padded);
+	}
+
+	//note: the 32-byte store writes 24 bytes, so it needs 8 more bytes of the room.
+	_KS_TARGET_AVX2
+	static const uint8_t* __base64_decode_avx2(const uint8_t* p, const uint8_t* end, uint8_t* dst, uint8_t* dst_end, bool is_url_safe) {
+		const __m256i v_ch62 = _mm256_set1_epi8(is_url_safe ? '-' : '+');
+		const __m256i v_ch63 = _mm256_set1_epi8(is_url_safe ? '_' : '/');
+		const __m256i v_offset62 = _mm256_set1_epi8(char(62 - (is_url_safe ? '-' : '+')));
+		const __m256i v_offset63 = _mm256_set1_epi8(char(63 - (is_url_safe ? '_' : '/')));
+
+		for (; end - p >= 32 && dst_end - dst >= 32; p += 32, dst += 24) {
+			const __m256i v = _mm256_loadu_si256((const __m256i*)p);
+			const __m256i is_upper = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('A' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), v));
+			const __m256i is_lower = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('a' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), v));
+			const __m256i is_digit = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('0' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), v));
+			const __m256i is_62 = _mm256_cmpeq_epi8(v, v_ch62);
+			const __m256i is_63 = _mm256_cmpeq_epi8(v, v_ch63);
+			const __m256i valid = _mm256_or_si256(_mm256_or_si256(_mm256_or_si256(is_upper, is_lower), is_digit), _mm256_or_si256(is_62, is_63));
+			if (_mm256_movemask_epi8(valid) != -1)
+				break; //the scalar step finds the invalid char
+
+			__m256i offsets = _mm256_or_si256(_mm256_and_si256(is_upper, _mm256_set1_epi8(-'A')), _mm256_and_si256(is_lower, _mm256_set1_epi8(26 - 'a')));
+			offsets = _mm256_or_si256(offsets, _mm256_and_si256(is_digit, _mm256_set1_epi8(52 - '0')));
+			offsets = _mm256_or_si256(offsets, _mm256_or_si256(_mm256_and_si256(is_62, v_offset62), _mm256_and_si256(is_63, v_offset63)));
+			const __m256i values = _mm256_add_epi8(v, offsets);
+
+			//4 values => 24 bits in each dword, then the 3 bytes are packed in the big-endian order
+			const __m256i merged = _mm256_madd_epi16(_mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140)), _mm256_set1_epi32(0x00011000));
+			const __m256i packed = _mm256_shuffle_epi8(merged, _mm256_setr_epi8(
+				2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+				2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+			_mm256_storeu_si256((__m256i*)dst, _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7)));
+		}
+
+		_mm256_zeroupper();
+		return __base64_decode_scalar(p, end, dst, is_url_safe ? s_base64_url_value_table.values : s_base64_value_table.values);
+	}
+#endif
+
+	static char* __base64_encode(const uint8_t* p, const uint8_t* end, char* dst, bool is_url_safe, bool is_padded) {
+#if _KS_SIMD_AVX2
+		if (__simd::cpu_has_avx2())
+			return __base64_encode_avx2(p, end, dst, is_url_safe, is_padded);
+#endif
+		return __base64_encode_scalar(p, end, dst, is_url_safe ? s_base64_url_chars : s_base64_chars, is_padded);
+	}
+
+	static const uint8_t* __base64_decode(const uint8_t* p, const uint8_t* end, uint8_t* dst, uint8_t* dst_end, bool is_url_safe) {
+#if _KS_SIMD_AVX2
+		if (__simd::cpu_has_avx2())
+			return __base64_decode_avx2(p, end, dst, dst_end, is_url_safe);
+#endif
+		return __base64_decode_scalar(p, end, dst, is_url_safe ? s_base64_url_value_table.values : s_base64_value_table.values);
+	}
+
+
+	//percent-encoding kernels
+
+	static inline bool __is_url_unreserved(uint8_t ch) {
+		const uint8_t ch_lower = ch | 0x20;
+		return (ch_lower >= 'a' && ch_lower <= 'z') || (ch >= '0' && ch <= '9') || ch == '-' || ch == '.' || ch == '_' || ch == '~';
+	}
+
+#if _KS_SIMD_SSE2
+	static inline __m128i __is_url_unreserved_sse2(__m128i v) {
+		const __m128i v_lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+		const __m128i is_alpha = _mm_and_si128(_mm_cmpgt_epi8(v_lower, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(v_lower, _mm_set1_epi8('z' + 1)));
+		const __m128i is_digit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1)));
+		const __m128i is_mark = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('-')), _mm_cmpeq_epi8(v, _mm_set1_epi8('.'))),
+			_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('_')), _mm_cmpeq_epi8(v, _mm_set1_epi8('~'))));
+		return _mm_or_si128(_mm_or_si128(is_alpha, is_digit), is_mark);
+	}
+#endif
+
+	static size_t __percent_escaped_count(const uint8_t* p, const uint8_t* end, bool is_form) {
+		size_t escaped_count = 0; //the count of the bytes taking %XX
+#if _KS_SIMD_SSE2
+		const __m128i v_space = _mm_set1_epi8(is_form ? ' ' : '-'); //- is kept anyway, so it does not change the count
+		for (; end - p >= 16; p += 16) {
+			const __m128i v = _mm_loadu_si128((const __m128i*)p);
+			const uint32_t kept_mask = (uint32_t)_mm_movemask_epi8(_mm_or_si128(__is_url_unreserved_sse2(v), _mm_cmpeq_epi8(v, v_space)));
+			escaped_count += 16 - __simd::popcount32(kept_mask);
+		}
+#endif
+		for (; p < end; ++p) {
+			if (!__is_url_unreserved(*p) && !(is_form && *p == ' '))
+				++escaped_count;
+		}
+		return escaped_count;
+	}
+
+	static char* __percent_encode_scalar(const uint8_t* p, const uint8_t* end, char* dst, bool is_form) {
+		for (; p < end; ++p) {
+			const uint8_t ch = *p;
+			if (__is_url_unreserved(ch)) {
+				*dst++ = char(ch);
+			}
+			else if (is_form && ch == ' ') {
+				*dst++ = '+';
+			}
+			else {
+				dst[0] = '%';
+				dst[1] = s_hex_upper_chars[ch >> 4];
+				dst[2] = s_hex_upper_chars[ch & 0x0F];
+				dst += 3;
+			}
+		}
+		return dst;
+	}
+
+	static char* __percent_encode(const uint8_t* p, const uint8_t* end, char* dst, bool is_form) {
+#if _KS_SIMD_SSE2
+		for (; end - p >= 16; p += 16) {
+			const __m128i v = _mm_loadu_si128((const __m128i*)p);
+			if (_mm_movemask_epi8(__is_url_unreserved_sse2(v)) == 0xFFFF) {
+				_mm_storeu_si128((__m128i*)dst, v);
+				dst += 16;
+			}
+			else {
+				dst = __percent_encode_scalar(p, p + 16, dst, is_form);
+			}
+		}
+#endif
+		return __percent_encode_scalar(p, end, dst, is_form);
+	}
+
+	//find the next % (or + in the form mode)
+	static const uint8_t* __find_percent_special(const uint8_t* p, const uint8_t* end, bool is_form) {
+#if _KS_SIMD_SSE2
+		const __m128i v_percent = _mm_set1_epi8('%');
+		const __m128i v_plus = _mm_set1_epi8(is_form ? '+' : '%');
+		for (; end - p >= 16; p += 16) {
+			const __m128i v = _mm_loadu_si128((const __m128i*)p);
+			const uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, v_percent), _mm_cmpeq_epi8(v, v_plus)));
+			if (mask != 0)
+				return p + __simd::ctz32(mask);
+		}
+#endif
+		while (p < end && *p != '%' && !(is_form && *p == '+'))
+			++p;
+		return p;
+	}
+
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	////////////////////////////////////////////////////////////////////////////////////////
+
+	MODERN_STRING_API
+	ks_immutable_string hex_encode(const ks_string_view& bytes, bool is_upper) {
+		if (bytes.empty())
+			return ks_immutable_string();
+
+		const uint8_t* const bytes_data = (const uint8_t*)bytes.data();
+		const size_t str_length = bytes.length() * 2;
+
+		ks_mutable_string str;
+		char* str_data = str.__begin_exclusive_writing(str_length);
+		char* str_data_p = __hex_encode(bytes_data, bytes_data + bytes.length(), str_data, is_upper);
+
+		ASSERT(str_data_p == str_data + str_length);
+		str.__end_exclusive_writing(str_data, str_data_p - str_data);
+		return std::move(str);
+	}
+
+	MODERN_STRING_API
+	ks_immutable_string hex_decode(const ks_string_view& str_view, size_t* error_pos) {
+		if (error_pos != nullptr)
+			*error_pos = size_t(-1);
+		if (str_view.empty())
+			return ks_immutable_string();
+
+		const uint8_t* const str_data = (const uint8_t*)str_view.data();
+		const size_t pair_length = str_view.length() & ~size_t(1);
+		const size_t bytes_length = pair_length / 2;
+
+		ks_mutable_string bytes;
+		uint8_t* bytes_data = (uint8_t*)bytes.__begin_exclusive_writing(bytes_length);
+		const uint8_t* str_data_p = __hex_decode(str_data, str_data + pair_length, bytes_data);
+
+		//note: the unpaired last char is an error also
+		if (str_data_p != str_data + str_view.length()) {
+			if (error_pos != nullptr)
+				*error_pos = str_data_p - str_data;
+			bytes.__end_exclusive_writing((char*)bytes_data, 0);
+			return ks_immutable_string();
+		}
+
+		bytes.__end_exclusive_writing((char*)bytes_data, bytes_length);
+		return std::move(bytes);
+	}
+
+	MODERN_STRING_API
+	ks_immutable_string base64_encode(const ks_string_view& bytes, bool is_url_safe, bool is_padded) {
+		if (bytes.empty())
+			return ks_immutable_string();
+
+		const uint8_t* const bytes_data = (const uint8_t*)bytes.data();
+		const size_t str_length = __base64_encoded_length(bytes.length(), is_padded);
+
+		ks_mutable_string str;
+		char* str_data = str.__begin_exclusive_writing(str_length);
+		char* str_data_p = __base64_encode(bytes_data, bytes_data + bytes.length(), str_data, is_url_safe, is_padded);
+
+		ASSERT(str_data_p == str_data + str_length);
+		str.__end_exclusive_writing(str_data, str_data_p - str_data);
+		return std::move(str);
+	}
+
+	MODERN_STRING_API
+	ks_immutable_string base64_decode(const ks_string_view& str_view, bool is_url_safe, size_t* error_pos) {
+		if (error_pos != nullptr)
+			*error_pos = size_t(-1);
+		if (str_view.empty())
+			return ks_immutable_string();
+
+		const uint8_t* const str_data = (const uint8_t*)str_view.data();
+		const int8_t* const values = is_url_safe ? s_base64_url_value_table.values : s_base64_value_table.values;
+
+		//the padding is only taken at the end of the padded form
+		size_t str_length = str_view.length();
+		if (str_length % 4 == 0 && str_data[str_length - 1] == '=') {
+			--str_length;
+			if (str_data[str_length - 1] == '=')
+				--str_length;
+		}
+
+		const size_t quad_length = str_length & ~size_t(3);
+		const size_t tail_length = str_length - quad_length;
+		const size_t bytes_length = quad_length / 4 * 3 + (tail_length == 0 ? 0 : tail_length - 1);
+
+		ks_mutable_string bytes;
+		uint8_t* bytes_data = (uint8_t*)bytes.__begin_exclusive_writing(bytes_length);
+		const uint8_t* str_data_p = __base64_decode(str_data, str_data + quad_length, bytes_data, bytes_data + bytes_length, is_url_safe);
+
+		//the tail of 2 or 3 chars takes 1 or 2 bytes, and a single char is never valid,
+		//the unused low bits of the last char must be zero (rfc 4648 3.5)
+		if (str_data_p == str_data + quad_length && tail_length != 0) {
+			uint32_t v = 0;
+			size_t i = 0;
+			for (; i < tail_length && values[str_data_p[i]] >= 0; ++i)
+				v |= uint32_t(values[str_data_p[i]]) << (18 - i * 6);
+
+			if (i == tail_length && tail_length != 1 && (v & (tail_length == 2 ? 0xFFFF : 0xFF)) == 0) {
+				uint8_t* bytes_tail = bytes_data + quad_length / 4 * 3;
+				bytes_tail[0] = uint8_t(v >> 16);
+				if (tail_length == 3)
+					bytes_tail[1] = uint8_t(v >> 8);
+				str_data_p += tail_length;
+			}
+			else {
+				str_data_p += (std::min)(i, tail_length - 1); //the invalid char, the single char, or the last char with pad bits
+			}
+		}
+
+		if (str_data_p != str_data + str_length) {
+			if (error_pos != nullptr)
+				*error_pos = str_data_p - str_data;
+			bytes.__end_exclusive_writing((char*)bytes_data, 0);
+			return ks_immutable_string();
+		}
+
+		bytes.__end_exclusive_writing((char*)bytes_data, bytes_length);
+		return std::move(bytes);
+	}
+
+	MODERN_STRING_API
+	ks_immutable_string percent_encode(const ks_string_view& bytes, bool is_form) {
+		if (bytes.empty())
+			return ks_immutable_string();
+
+		const uint8_t* const bytes_data = (const uint8_t*)bytes.data();
+		const uint8_t* const bytes_end = bytes_data + bytes.length();
+		const size_t escaped_count = __percent_escaped_count(bytes_data, bytes_end, is_form);
+		const size_t str_length = bytes.length() + escaped_count * 2;
+
+		ks_mutable_string str;
+		char* str_data = str.__begin_exclusive_writing(str_length);
+		char* str_data_p = __percent_encode(bytes_data, bytes_end, str_data, is_form);
+
+		ASSERT(str_data_p == str_data + str_length);
+		str.__end_exclusive_writing(str_data, str_data_p - str_data);
+		return std::move(str);
+	}
+
+	MODERN_STRING_API
+	ks_immutable_string percent_decode(const ks_string_view& str_view, bool is_form, size_t* error_pos) {
+		if (error_pos != nullptr)
+			*error_pos = size_t(-1);
+		if (str_view.empty())
+			return ks_immutable_string();
+
+		const uint8_t* const str_data = (const uint8_t*)str_view.data();
+		const uint8_t* const str_end = str_data + str_view.length();
+
+		//the 1st pass checks the escapes and counts them, the hex digits after % can not be %, so the escapes never overlap
+		size_t escape_count = 0;
+		for (const uint8_t* p = __find_percent_special(str_data, str_end, false); p != str_end; p = __find_percent_special(p + 3, str_end, false)) {
+			if (str_end - p < 3 || __hex_value_of(p[1]) < 0 || __hex_value_of(p[2]) < 0) {
+				if (error_pos != nullptr)
+					*error_pos = p - str_data;
+				return ks_immutable_string();
+			}
+			++escape_count;
+		}
+
+		const size_t bytes_length = str_view.length() - escape_count * 2;
+
+		ks_mutable_string bytes;
+		char* bytes_data = bytes.__begin_exclusive_writing(bytes_length);
+		char* bytes_data_p = bytes_data;
+		for (const uint8_t* p = str_data; p != str_end; ) {
+			const uint8_t* special = __find_percent_special(p, str_end, is_form);
+			bytes_data_p = std::copy(p, special, bytes_data_p);
+			if (special == str_end)
+				break;
+
+			if (*special == '+') {
+				*bytes_data_p++ = ' ';
+				p = special + 1;
+			}
+			else {
+				*bytes_data_p++ = char(__hex_value_of(special[1]) << 4 | __hex_value_of(special[2]));
+				p = special + 3;
+			}
+		}
+
+		ASSERT(bytes_data_p == bytes_data + bytes_length);
+		bytes.__end_exclusive_writing(bytes_data, bytes_length);
+		return std::move(bytes);
+	}
+}
@@ -0,0 +1,43 @@
+﻿/* Copyright 2024 The Kingsoft's modern-string Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include "ks_string.h"
+
+namespace ks_string_util {
+	//the byte codecs, the output is presized, so it is allocated only once.
+	//the decoders return an empty string for the invalid input, and error_pos takes the offset of the first invalid char, or size_t(-1).
+
+	//hex: 2 chars per byte, the decoder accepts both cases
+	MODERN_STRING_API
+	ks_immutable_string hex_encode(const ks_string_view& bytes, bool is_upper = false);
+	MODERN_STRING_API
+	ks_immutable_string hex_decode(const ks_string_view& str_view, size_t* error_pos = nullptr);
+
+	//base64 (rfc 4648): the url-safe alphabet takes - and _ instead of + and /,
+	//the decoder accepts the input with or without the padding, but rejects non-zero pad bits
+	MODERN_STRING_API
+	ks_immutable_string base64_encode(const ks_string_view& bytes, bool is_url_safe = false, bool is_padded = true);
+	MODERN_STRING_API
+	ks_immutable_string base64_decode(const ks_string_view& str_view, bool is_url_safe = false, size_t* error_pos = nullptr);
+
+	//percent-encoding (rfc 3986): all bytes but the unreserved chars (alnum and -._~) are escaped as %XX,
+	//and the form mode (application/x-www-form-urlencoded) takes + for the space
+	MODERN_STRING_API
+	ks_immutable_string percent_encode(const ks_string_view& bytes, bool is_form = false);
+	MODERN_STRING_API
+	ks_immutable_string percent_decode(const ks_string_view& str_view, bool is_form = false, size_t* error_pos = nullptr);
+}
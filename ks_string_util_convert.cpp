@@ -14,6 +14,9 @@ limitations under the License.
 ==============================================================================*/
 
 #include "ks_string_util_convert.h"
+#include "ks_string_util_simd.h"
+#include <atomic>
+#include <memory>
 
 #ifdef _WIN32
 #include <Windows.h>
@@ -25,6 +28,1338 @@ limitations under the License.
 #endif
 
 namespace ks_string_util {
+	//utf8 => utf16 kernels
+	//note: the invalid sequences are consumed in the same way as before (the trailing bytes are taken without checking),
+	//so the simd paths only accept the well-formed blocks, and leave the others to the scalar step.
+
+	static inline uint __u8_trailing_count(uint8_t ch8) {
+		return ch8 <= 0xBF ? 0 : ch8 <= 0xDF ? 1 : ch8 <= 0xEF ? 2 : ch8 <= 0xF7 ? 3 : 0;
+	}
+
+	static size_t __count_u16_of_u8_scalar(const uint8_t* p8, const uint8_t* end8) {
+		size_t wch_count = 0;
+		while (p8 < end8) {
+			uint8_t ch8 = *(p8++);
+			size_t len8_addi = (std::min)(size_t(__u8_trailing_count(ch8)), size_t(end8 - p8));
+			p8 += len8_addi;
+			wch_count += (ch8 >= 0xF0 && ch8 <= 0xF7) ? 2 : 1; //因为rune >= 0x10000
+		}
+		return wch_count;
+	}
+
+	static size_t __count_u16_of_u8(const uint8_t* p8, size_t len8) {
+#if _KS_SIMD_SSE2
+		if (len8 >= 16) {
+			//for well-formed input, count = non-continuation bytes + 4-byte leads.
+			//the structure is verified alongside: every continuation byte must be expected by a lead, and vice versa.
+			const __m128i v_c0 = _mm_set1_epi8((char)0xC0);
+			const __m128i v_e0 = _mm_set1_epi8((char)0xE0);
+			const __m128i v_f0 = _mm_set1_epi8((char)0xF0);
+			const __m128i v_f8 = _mm_set1_epi8((char)0xF8);
+			__m128i prev_need1 = _mm_setzero_si128(), prev_need2 = _mm_setzero_si128(), prev_need3 = _mm_setzero_si128();
+			__m128i bad = _mm_setzero_si128();
+			__m128i cont_acc = _mm_setzero_si128(), lead4_acc = _mm_setzero_si128(); //byte-wise counters, folded before overflow
+			__m128i cont_sum = _mm_setzero_si128(), lead4_sum = _mm_setzero_si128();
+			size_t pos8 = 0;
+			for (size_t round = 0; pos8 + 16 <= len8; pos8 += 16) {
+				__m128i v = _mm_loadu_si128((const __m128i*)(p8 + pos8));
+				__m128i is_cont = _mm_cmplt_epi8(v, v_c0); //signed: 0x80..0xBF
+				__m128i need1 = __simd::cmpge_epu8(v, v_c0);
+				__m128i need2 = __simd::cmpge_epu8(v, v_e0);
+				__m128i need3 = __simd::cmpge_epu8(v, v_f0);
+				__m128i expected = _mm_or_si128(
+					_mm_or_si128(_mm_slli_si128(need1, 1), _mm_srli_si128(prev_need1, 15)),
+					_mm_or_si128(
+						_mm_or_si128(_mm_slli_si128(need2, 2), _mm_srli_si128(prev_need2, 14)),
+						_mm_or_si128(_mm_slli_si128(need3, 3), _mm_srli_si128(prev_need3, 13))));
+				bad = _mm_or_si128(bad, _mm_or_si128(_mm_xor_si128(expected, is_cont), __simd::cmpge_epu8(v, v_f8)));
+				cont_acc = _mm_sub_epi8(cont_acc, is_cont);
+				lead4_acc = _mm_sub_epi8(lead4_acc, need3);
+				if (++round == 255) {
+					cont_sum = _mm_add_epi64(cont_sum, _mm_sad_epu8(cont_acc, _mm_setzero_si128()));
+					lead4_sum = _mm_add_epi64(lead4_sum, _mm_sad_epu8(lead4_acc, _mm_setzero_si128()));
+					cont_acc = lead4_acc = _mm_setzero_si128();
+					round = 0;
+				}
+				prev_need1 = need1;
+				prev_need2 = need2;
+				prev_need3 = need3;
+			}
+
+			if (_mm_movemask_epi8(bad) != 0)
+				return __count_u16_of_u8_scalar(p8, p8 + len8);
+
+			cont_sum = _mm_add_epi64(cont_sum, _mm_sad_epu8(cont_acc, _mm_setzero_si128()));
+			lead4_sum = _mm_add_epi64(lead4_sum, _mm_sad_epu8(lead4_acc, _mm_setzero_si128()));
+			uint64_t cont_lanes[2], lead4_lanes[2];
+			_mm_storeu_si128((__m128i*)cont_lanes, cont_sum);
+			_mm_storeu_si128((__m128i*)lead4_lanes, lead4_sum);
+			size_t wch_count = pos8 - size_t(cont_lanes[0] + cont_lanes[1]) + size_t(lead4_lanes[0] + lead4_lanes[1]);
+
+			//skip the trailing bytes of the last sequence, which have been counted already
+			size_t pending = 0;
+			for (size_t j = 1; j <= 3; ++j) {
+				uint8_t ch8 = p8[pos8 - j];
+				if ((ch8 & 0xC0) != 0x80) {
+					uint trailing = __u8_trailing_count(ch8);
+					pending = trailing >= j ? trailing - (j - 1) : 0;
+					break;
+				}
+			}
+
+			pos8 += (std::min)(pending, len8 - pos8);
+			return wch_count + __count_u16_of_u8_scalar(p8 + pos8, p8 + len8);
+		}
+#endif
+		return __count_u16_of_u8_scalar(p8, p8 + len8);
+	}
+
+	static inline const uint8_t* __decode_u8_step(const uint8_t* p8, const uint8_t* end8, WCHAR*& p16) {
+		uint8_t ch8 = *(p8++);
+		if (ch8 <= 0xBF) {
+			//0xxxxxxx
+			//10xxxxxx (invalid)
+			ASSERT(ch8 <= 0x7F);
+			*(p16++) = (WCHAR)(ch8);
+		}
+		else if (ch8 <= 0xDF) {
+			//110xxxxx 10xxxxxx
+			ASSERT(p8 < end8 && (*p8 & 0xC0) == 0x80);
+			uint8_t ch8_addi = p8 < end8 ? *(p8++) : 0;
+			uint rune = ((uint(ch8) & 0x01F) << 6) + ((uint(ch8_addi) & 0x3F));
+			*(p16++) = (WCHAR)(rune);
+		}
+		else if (ch8 <= 0xEF) {
+			//1110xxxx 10xxxxxx 10xxxxxx
+			uint8_t ch8_addi_arr[2] = { 0, 0 };
+			size_t len8_addi = (std::min)(size_t(2), size_t(end8 - p8));
+			ASSERT(len8_addi == 2 && (p8[0] & 0xC0) == 0x80 && (p8[1] & 0xC0) == 0x80);
+			std::copy_n(p8, len8_addi, ch8_addi_arr);
+			p8 += len8_addi;
+			uint rune = ((uint(ch8) & 0x0F) << 12) + ((uint(ch8_addi_arr[0]) & 0x3F) << 6) + ((uint(ch8_addi_arr[1]) & 0x3F));
+			*(p16++) = (WCHAR)(rune);
+		}
+		else if (ch8 <= 0xF7) {
+			//11110xxx 10xxxxxx 10xxxxxx 10xxxxxx
+			uint8_t ch8_addi_arr[3] = { 0, 0, 0 };
+			size_t len8_addi = (std::min)(size_t(3), size_t(end8 - p8));
+			ASSERT(len8_addi == 3 && (p8[0] & 0xC0) == 0x80 && (p8[1] & 0xC0) == 0x80 && (p8[2] & 0xC0) == 0x80);
+			std::copy_n(p8, len8_addi, ch8_addi_arr);
+			p8 += len8_addi;
+			uint rune = ((uint(ch8) & 0x07) << 18) + ((uint(ch8_addi_arr[0]) & 0x3F) << 12) + ((uint(ch8_addi_arr[1]) & 0x3F) << 6) + ((uint(ch8_addi_arr[2]) & 0x3F));
+			ASSERT(rune >= 0x10000);
+			rune -= 0x10000;
+			ASSERT((rune & ~0xFFFFF) == 0);
+			*(p16++) = (WCHAR)(0xD800 | ((rune & 0xFFC00) >> 10));
+			*(p16++) = (WCHAR)(0xDC00 | ((rune & 0x003FF)));
+		}
+		else {
+			//11111xxx (invalid)
+			ASSERT(false);
+			*(p16++) = (WCHAR)(ch8);
+		}
+		return p8;
+	}
+
+#if _KS_SIMD_SSE2
+	//widen 16 ascii bytes, return the length of the ascii prefix (the whole 16 units are stored when space is enough)
+	static inline size_t __decode_u8_ascii16_sse2(const uint8_t* p8, WCHAR* p16, size_t space16) {
+		__m128i v = _mm_loadu_si128((const __m128i*)p8);
+		uint32_t mask = (uint32_t)_mm_movemask_epi8(v);
+		size_t n = mask == 0 ? 16 : __simd::ctz32(mask);
+		if (n != 0) {
+			if (space16 >= 16) {
+				const __m128i zero = _mm_setzero_si128();
+				_mm_storeu_si128((__m128i*)p16, _mm_unpacklo_epi8(v, zero));
+				_mm_storeu_si128((__m128i*)(p16 + 8), _mm_unpackhi_epi8(v, zero));
+			}
+			else {
+				std::copy_n(p8, n, p16);
+			}
+		}
+		return n;
+	}
+
+	//decode the prefix of 2-byte sequences in 16 bytes, return the number of sequences (8 units are stored)
+	static inline size_t __decode_u8_2byte16_sse2(const uint8_t* p8, WCHAR* p16, size_t space16) {
+		if (space16 < 8)
+			return 0;
+		__m128i v = _mm_loadu_si128((const __m128i*)p8);
+		//per 16-bit word: lo=110xxxxx, hi=10xxxxxx
+		__m128i ok = _mm_cmpeq_epi8(_mm_and_si128(v, _mm_set1_epi16((short)0xC0E0)), _mm_set1_epi16((short)0x80C0));
+		uint32_t fail = ~(uint32_t)_mm_movemask_epi8(ok);
+		size_t n = __simd::ctz32(fail | 0x10000) / 2;
+		if (n != 0) {
+			__m128i lo = _mm_slli_epi16(_mm_and_si128(v, _mm_set1_epi16(0x001F)), 6);
+			__m128i hi = _mm_and_si128(_mm_srli_epi16(v, 8), _mm_set1_epi16(0x003F));
+			_mm_storeu_si128((__m128i*)p16, _mm_or_si128(lo, hi));
+		}
+		return n;
+	}
+
+	static WCHAR* __decode_u8_sse2(const uint8_t* p8, const uint8_t* end8, WCHAR* p16, WCHAR* end16) {
+		while (end8 - p8 >= 16) {
+			size_t n = __decode_u8_ascii16_sse2(p8, p16, end16 - p16);
+			if (n != 0) {
+				p8 += n;
+				p16 += n;
+				continue;
+			}
+
+			n = __decode_u8_2byte16_sse2(p8, p16, end16 - p16);
+			if (n != 0) {
+				p8 += n * 2;
+				p16 += n;
+				continue;
+			}
+
+			p8 = __decode_u8_step(p8, end8, p16);
+		}
+
+		while (p8 < end8)
+			p8 = __decode_u8_step(p8, end8, p16);
+		return p16;
+	}
+#endif
+
+#if _KS_SIMD_AVX2
+	//decode the prefix of 3-byte sequences in 16 bytes, return the number of sequences (8 units are stored)
+	_KS_TARGET_AVX2
+	static inline size_t __decode_u8_3byte16_avx2(const uint8_t* p8, WCHAR* p16, size_t space16) {
+		if (space16 < 8)
+			return 0;
+		__m128i v = _mm_loadu_si128((const __m128i*)p8);
+		//per byte triple: 1110xxxx 10xxxxxx 10xxxxxx
+		const __m128i pattern_mask = _mm_setr_epi8(
+			(char)0xF0, (char)0xC0, (char)0xC0, (char)0xF0, (char)0xC0, (char)0xC0, (char)0xF0, (char)0xC0,
+			(char)0xC0, (char)0xF0, (char)0xC0, (char)0xC0, (char)0xF0, (char)0xC0, (char)0xC0, 0);
+		const __m128i pattern_value = _mm_setr_epi8(
+			(char)0xE0, (char)0x80, (char)0x80, (char)0xE0, (char)0x80, (char)0x80, (char)0xE0, (char)0x80,
+			(char)0x80, (char)0xE0, (char)0x80, (char)0x80, (char)0xE0, (char)0x80, (char)0x80, 0);
+		__m128i ok = _mm_cmpeq_epi8(_mm_and_si128(v, pattern_mask), pattern_value);
+		uint32_t fail = ~(uint32_t)_mm_movemask_epi8(ok);
+		size_t n = __simd::ctz32(fail | 0x8000) / 3;
+		if (n != 0) {
+			//a: lo=byte2, hi=byte0;  b: lo=byte1, hi=0
+			const __m128i shuffle_a = _mm_setr_epi8(2, 0, 5, 3, 8, 6, 11, 9, 14, 12, -1, -1, -1, -1, -1, -1);
+			const __m128i shuffle_b = _mm_setr_epi8(1, -1, 4, -1, 7, -1, 10, -1, 13, -1, -1, -1, -1, -1, -1, -1);
+			__m128i a = _mm_shuffle_epi8(v, shuffle_a);
+			__m128i b = _mm_shuffle_epi8(v, shuffle_b);
+			__m128i u = _mm_or_si128(
+				_mm_and_si128(_mm_slli_epi16(a, 4), _mm_set1_epi16((short)0xF000)),
+				_mm_or_si128(_mm_and_si128(a, _mm_set1_epi16(0x003F)), _mm_slli_epi16(_mm_and_si128(b, _mm_set1_epi16(0x003F)), 6)));
+			_mm_storeu_si128((__m128i*)p16, u);
+		}
+		return n;
+	}
+
+	_KS_TARGET_AVX2
+	static WCHAR* __decode_u8_avx2(const uint8_t* p8, const uint8_t* end8, WCHAR* p16, WCHAR* end16) {
+		while (end8 - p8 >= 32) {
+			__m256i v = _mm256_loadu_si256((const __m256i*)p8);
+			if (_mm256_movemask_epi8(v) == 0 && end16 - p16 >= 32) {
+				_mm256_storeu_si256((__m256i*)p16, _mm256_cvtepu8_epi16(_mm256_castsi256_si128(v)));
+				_mm256_storeu_si256((__m256i*)(p16 + 16), _mm256_cvtepu8_epi16(_mm256_extracti128_si256(v, 1)));
+				p8 += 32;
+				p16 += 32;
+				continue;
+			}
+
+			size_t n = __decode_u8_ascii16_sse2(p8, p16, end16 - p16);
+			if (n != 0) {
+				p8 += n;
+				p16 += n;
+				continue;
+			}
+
+			n = __decode_u8_3byte16_avx2(p8, p16, end16 - p16);
+			if (n != 0) {
+				p8 += n * 3;
+				p16 += n;
+				continue;
+			}
+
+			n = __decode_u8_2byte16_sse2(p8, p16, end16 - p16);
+			if (n != 0) {
+				p8 += n * 2;
+				p16 += n;
+				continue;
+			}
+
+			p8 = __decode_u8_step(p8, end8, p16);
+		}
+
+		_mm256_zeroupper(); //leave the avx state before the sse2 code, to avoid the transition penalty
+		return __decode_u8_sse2(p8, end8, p16, end16);
+	}
+#endif
+
+	static WCHAR* __decode_u8(const uint8_t* p8, const uint8_t* end8, WCHAR* p16, WCHAR* end16) {
+#if _KS_SIMD_AVX2
+		if (__simd::cpu_has_avx2())
+			return __decode_u8_avx2(p8, end8, p16, end16);
+#endif
+#if _KS_SIMD_SSE2
+		return __decode_u8_sse2(p8, end8, p16, end16);
+#else
+		while (p8 < end8)
+			p8 = __decode_u8_step(p8, end8, p16);
+		return p16;
+#endif
+	}
+
+
+	//utf16 => utf8 kernels
+	//note: like the rune decoding, a surrogate pair takes 4 bytes, and a lone surrogate is encoded by itself in 3 bytes,
+	//and the simd paths only accept the well-formed runs.
+
+	//the length of a single unit (not a surrogate pair)
+	static inline size_t __u8_length_of_u16_unit(WCHAR ch) {
+		return ch <= 0x7F ? 1 : ch <= 0x7FF ? 2 : 3;
+	}
+
+	static inline bool __is_u16_pair_at(const WCHAR* p, const WCHAR* end) {
+		return (p[0] & 0xFC00) == 0xD800 && p + 1 < end && (p[1] & 0xFC00) == 0xDC00;
+	}
+
+	static size_t __count_u8_of_u16_scalar(const WCHAR* p, const WCHAR* end) {
+		size_t char8_count = 0;
+		while (p < end) {
+			if (__is_u16_pair_at(p, end)) {
+				char8_count += 4;
+				p += 2;
+			}
+			else {
+				char8_count += __u8_length_of_u16_unit(*(p++));
+			}
+		}
+		return char8_count;
+	}
+
+	static size_t __count_u8_of_u16(const WCHAR* p, size_t len) {
+#if _KS_SIMD_SSE2
+		if (len >= 8) {
+			//for well-formed input, count = sum of (3 - [ch < 0x80] - [ch < 0x800]) - 2 * high-surrogates.
+			//the surrogate pairing is verified alongside, and the negative terms are accumulated as word-wise masks.
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i v_fc00 = _mm_set1_epi16((short)0xFC00);
+			const __m128i v_d800 = _mm_set1_epi16((short)0xD800);
+			const __m128i v_dc00 = _mm_set1_epi16((short)0xDC00);
+			__m128i prev_high = zero, bad = zero;
+			__m128i acc = zero, sum = zero;
+			size_t pos = 0;
+			for (size_t round = 0; pos + 8 <= len; pos += 8) {
+				__m128i v = _mm_loadu_si128((const __m128i*)(p + pos));
+				__m128i lt80 = _mm_cmpeq_epi16(_mm_and_si128(v, _mm_set1_epi16((short)0xFF80)), zero);
+				__m128i lt800 = _mm_cmpeq_epi16(_mm_and_si128(v, _mm_set1_epi16((short)0xF800)), zero);
+				__m128i high = _mm_cmpeq_epi16(_mm_and_si128(v, v_fc00), v_d800);
+				__m128i low = _mm_cmpeq_epi16(_mm_and_si128(v, v_fc00), v_dc00);
+				__m128i expected_low = _mm_or_si128(_mm_slli_si128(high, 2), _mm_srli_si128(prev_high, 14));
+				bad = _mm_or_si128(bad, _mm_xor_si128(expected_low, low));
+				acc = _mm_add_epi16(acc, _mm_add_epi16(_mm_add_epi16(lt80, lt800), _mm_add_epi16(high, high)));
+				if (++round == 8000) {
+					sum = _mm_add_epi32(sum, _mm_madd_epi16(acc, _mm_set1_epi16(1)));
+					acc = zero;
+					round = 0;
+				}
+				prev_high = high;
+			}
+
+			if (_mm_movemask_epi8(bad) != 0)
+				return __count_u8_of_u16_scalar(p, p + len);
+
+			sum = _mm_add_epi32(sum, _mm_madd_epi16(acc, _mm_set1_epi16(1)));
+			int32_t sum_lanes[4];
+			_mm_storeu_si128((__m128i*)sum_lanes, sum);
+			size_t char8_count = pos * 3 - size_t(-(int64_t(sum_lanes[0]) + sum_lanes[1] + sum_lanes[2] + sum_lanes[3]));
+
+			//the high surrogate at the end is counted as 1, then it takes 3 more with the low surrogate left behind, or 2 more if lone
+			if ((p[pos - 1] & 0xFC00) == 0xD800) {
+				if (pos < len && (p[pos] & 0xFC00) == 0xDC00) {
+					char8_count += 3;
+					pos += 1;
+				}
+				else {
+					char8_count += 2;
+				}
+			}
+			return char8_count + __count_u8_of_u16_scalar(p + pos, p + len);
+		}
+#endif
+		return __count_u8_of_u16_scalar(p, p + len);
+	}
+
+	//return null if the space is not enough
+	static inline const WCHAR* __encode_u16_step(const WCHAR* p, const WCHAR* end, uint8_t*& p8, uint8_t* end8) {
+		WCHAR ch = *p;
+		const bool is_pair = __is_u16_pair_at(p, end);
+		if (size_t(end8 - p8) < (is_pair ? 4 : __u8_length_of_u16_unit(ch)))
+			return nullptr;
+		++p;
+
+		if (is_pair) {
+			WCHAR ch_addi = *(p++);
+			uint rune = 0x10000 + (((uint(ch) & 0x3FF) << 10) | (uint(ch_addi) & 0x3FF));
+			//11110xxx 10xxxxxx 10xxxxxx 10xxxxxx
+			*(p8++) = (uint8_t)(0xF0 | ((rune & 0x1C0000) >> 18));
+			*(p8++) = (uint8_t)(0x80 | ((rune & 0x03F000) >> 12));
+			*(p8++) = (uint8_t)(0x80 | ((rune & 0x000FC0) >> 6));
+			*(p8++) = (uint8_t)(0x80 | ((rune & 0x00003F)));
+		}
+		else {
+			if (ch <= 0x7F) {
+				//0xxxxxxx
+				*(p8++) = (uint8_t)(ch);
+			}
+			else if (ch <= 0x7FF) {
+				//110xxxxx 10xxxxxx
+				*(p8++) = (uint8_t)(0xC0 | ((ch & 0x7C0) >> 6));
+				*(p8++) = (uint8_t)(0x80 | ((ch & 0x003F)));
+			}
+			else {
+				//1110xxxx 10xxxxxx 10xxxxxx
+				*(p8++) = (uint8_t)(0xE0 | ((ch & 0xF000) >> 12));
+				*(p8++) = (uint8_t)(0x80 | ((ch & 0x0FC0) >> 6));
+				*(p8++) = (uint8_t)(0x80 | ((ch & 0x003F)));
+			}
+		}
+		return p;
+	}
+
+#if _KS_SIMD_SSE2
+	//narrow the ascii prefix of 8 units, return the length of the prefix (8 bytes are stored)
+	static inline size_t __encode_u16_ascii8_sse2(const WCHAR* p, uint8_t* p8, size_t space8) {
+		if (space8 < 8)
+			return 0;
+		__m128i v = _mm_loadu_si128((const __m128i*)p);
+		__m128i ok = _mm_cmpeq_epi16(_mm_and_si128(v, _mm_set1_epi16((short)0xFF80)), _mm_setzero_si128());
+		size_t n = __simd::ctz32(~(uint32_t)_mm_movemask_epi8(ok) | 0x10000) / 2;
+		if (n != 0)
+			_mm_storel_epi64((__m128i*)p8, _mm_packus_epi16(v, v));
+		return n;
+	}
+
+	//encode the prefix of 8 units which need 2 bytes, return the length of the prefix (16 bytes are stored)
+	static inline size_t __encode_u16_2byte8_sse2(const WCHAR* p, uint8_t* p8, size_t space8) {
+		if (space8 < 16)
+			return 0;
+		__m128i v = _mm_loadu_si128((const __m128i*)p);
+		__m128i ok = _mm_andnot_si128(
+			_mm_cmpeq_epi16(_mm_and_si128(v, _mm_set1_epi16((short)0xFF80)), _mm_setzero_si128()),
+			_mm_cmpeq_epi16(_mm_and_si128(v, _mm_set1_epi16((short)0xF800)), _mm_setzero_si128()));
+		size_t n = __simd::ctz32(~(uint32_t)_mm_movemask_epi8(ok) | 0x10000) / 2;
+		if (n != 0) {
+			//per 16-bit word: lo=110xxxxx, hi=10xxxxxx
+			__m128i lo = _mm_srli_epi16(v, 6);
+			__m128i hi = _mm_slli_epi16(_mm_and_si128(v, _mm_set1_epi16(0x003F)), 8);
+			_mm_storeu_si128((__m128i*)p8, _mm_or_si128(_mm_or_si128(lo, hi), _mm_set1_epi16((short)0x80C0)));
+		}
+		return n;
+	}
+
+	//encode the prefix of 4 surrogate pairs, return the count of pairs (16 bytes are stored)
+	static inline size_t __encode_u16_4byte8_sse2(const WCHAR* p, uint8_t* p8, size_t space8) {
+		if (space8 < 16)
+			return 0;
+		__m128i v = _mm_loadu_si128((const __m128i*)p);
+		//per 32-bit lane: lo=high-surrogate, hi=low-surrogate
+		__m128i ok = _mm_cmpeq_epi32(_mm_and_si128(v, _mm_set1_epi32((int)0xFC00FC00)), _mm_set1_epi32((int)0xDC00D800));
+		size_t n = __simd::ctz32(~(uint32_t)_mm_movemask_epi8(ok) | 0x10000) / 4;
+		if (n != 0) {
+			const __m128i v_3f = _mm_set1_epi32(0x3F);
+			__m128i rune = _mm_add_epi32(
+				_mm_or_si128(_mm_slli_epi32(_mm_and_si128(v, _mm_set1_epi32(0x3FF)), 10), _mm_and_si128(_mm_srli_epi32(v, 16), _mm_set1_epi32(0x3FF))),
+				_mm_set1_epi32(0x10000));
+			//11110xxx 10xxxxxx 10xxxxxx 10xxxxxx
+			__m128i u8 = _mm_or_si128(
+				_mm_or_si128(_mm_srli_epi32(rune, 18), _mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(rune, 12), v_3f), 8)),
+				_mm_or_si128(_mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(rune, 6), v_3f), 16), _mm_slli_epi32(_mm_and_si128(rune, v_3f), 24)));
+			_mm_storeu_si128((__m128i*)p8, _mm_or_si128(u8, _mm_set1_epi32((int)0x808080F0)));
+		}
+		return n;
+	}
+
+	static uint8_t* __encode_u16_sse2(const WCHAR* p, const WCHAR* end, uint8_t* p8, uint8_t* end8) {
+		while (end - p >= 16) {
+			if (end8 - p8 >= 16) {
+				__m128i v0 = _mm_loadu_si128((const __m128i*)p);
+				__m128i v1 = _mm_loadu_si128((const __m128i*)(p + 8));
+				if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(_mm_or_si128(v0, v1), _mm_set1_epi16((short)0xFF80)), _mm_setzero_si128())) == 0xFFFF) {
+					_mm_storeu_si128((__m128i*)p8, _mm_packus_epi16(v0, v1));
+					p += 16;
+					p8 += 16;
+					continue;
+				}
+			}
+
+			size_t n = __encode_u16_ascii8_sse2(p, p8, end8 - p8);
+			if (n != 0) {
+				p += n;
+				p8 += n;
+				continue;
+			}
+
+			n = __encode_u16_2byte8_sse2(p, p8, end8 - p8);
+			if (n != 0) {
+				p += n;
+				p8 += n * 2;
+				continue;
+			}
+
+			n = __encode_u16_4byte8_sse2(p, p8, end8 - p8);
+			if (n != 0) {
+				p += n * 2;
+				p8 += n * 4;
+				continue;
+			}
+
+			p = __encode_u16_step(p, end, p8, end8);
+			if (p == nullptr)
+				return nullptr;
+		}
+
+		while (p < end) {
+			p = __encode_u16_step(p, end, p8, end8);
+			if (p == nullptr)
+				return nullptr;
+		}
+		return p8;
+	}
+#endif
+
+#if _KS_SIMD_AVX2
+	//encode the prefix of 8 units which need 3 bytes, return the length of the prefix (28 bytes are stored)
+	_KS_TARGET_AVX2
+	static inline size_t __encode_u16_3byte8_avx2(const WCHAR* p, uint8_t* p8, size_t space8) {
+		if (space8 < 28)
+			return 0;
+		__m128i v = _mm_loadu_si128((const __m128i*)p);
+		__m128i ok = _mm_andnot_si128(
+			_mm_or_si128(
+				_mm_cmpeq_epi16(_mm_and_si128(v, _mm_set1_epi16((short)0xF800)), _mm_setzero_si128()),
+				_mm_cmpeq_epi16(_mm_and_si128(v, _mm_set1_epi16((short)0xF800)), _mm_set1_epi16((short)0xD800))),
+			_mm_set1_epi16(-1));
+		size_t n = __simd::ctz32(~(uint32_t)_mm_movemask_epi8(ok) | 0x10000) / 2;
+		if (n != 0) {
+			//a: lo=1110xxxx, hi=10xxxxxx;  b: lo=10xxxxxx, hi=0
+			__m128i a = _mm_or_si128(
+				_mm_or_si128(_mm_srli_epi16(v, 12), _mm_slli_epi16(_mm_and_si128(_mm_srli_epi16(v, 6), _mm_set1_epi16(0x003F)), 8)),
+				_mm_set1_epi16((short)0x80E0));
+			__m128i b = _mm_or_si128(_mm_and_si128(v, _mm_set1_epi16(0x003F)), _mm_set1_epi16(0x0080));
+			const __m128i shuffle = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+			_mm_storeu_si128((__m128i*)p8, _mm_shuffle_epi8(_mm_unpacklo_epi16(a, b), shuffle));
+			_mm_storeu_si128((__m128i*)(p8 + 12), _mm_shuffle_epi8(_mm_unpackhi_epi16(a, b), shuffle));
+		}
+		return n;
+	}
+
+	_KS_TARGET_AVX2
+	static uint8_t* __encode_u16_avx2(const WCHAR* p, const WCHAR* end, uint8_t* p8, uint8_t* end8) {
+		while (end - p >= 32) {
+			if (end8 - p8 >= 32) {
+				__m256i v0 = _mm256_loadu_si256((const __m256i*)p);
+				__m256i v1 = _mm256_loadu_si256((const __m256i*)(p + 16));
+				if (_mm256_testz_si256(_mm256_or_si256(v0, v1), _mm256_set1_epi16((short)0xFF80))) {
+					__m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(v0, v1), 0xD8);
+					_mm256_storeu_si256((__m256i*)p8, packed);
+					p += 32;
+					p8 += 32;
+					continue;
+				}
+			}
+
+			size_t n = __encode_u16_ascii8_sse2(p, p8, end8 - p8);
+			if (n != 0) {
+				p += n;
+				p8 += n;
+				continue;
+			}
+
+			n = __encode_u16_3byte8_avx2(p, p8, end8 - p8);
+			if (n != 0) {
+				p += n;
+				p8 += n * 3;
+				continue;
+			}
+
+			n = __encode_u16_2byte8_sse2(p, p8, end8 - p8);
+			if (n != 0) {
+				p += n;
+				p8 += n * 2;
+				continue;
+			}
+
+			n = __encode_u16_4byte8_sse2(p, p8, end8 - p8);
+			if (n != 0) {
+				p += n * 2;
+				p8 += n * 4;
+				continue;
+			}
+
+			p = __encode_u16_step(p, end, p8, end8);
+			if (p == nullptr)
+				return nullptr;
+		}
+
+		_mm256_zeroupper();
+		return __encode_u16_sse2(p, end, p8, end8);
+	}
+#endif
+
+	//return null if the space is not enough
+	static uint8_t* __encode_u16(const WCHAR* p, const WCHAR* end, uint8_t* p8, uint8_t* end8) {
+#if _KS_SIMD_AVX2
+		if (__simd::cpu_has_avx2())
+			return __encode_u16_avx2(p, end, p8, end8);
+#endif
+#if _KS_SIMD_SSE2
+		return __encode_u16_sse2(p, end, p8, end8);
+#else
+		while (p < end) {
+			p = __encode_u16_step(p, end, p8, end8);
+			if (p == nullptr)
+				return nullptr;
+		}
+		return p8;
+#endif
+	}
+
+
+	//utf8/utf16 validation
+	//note: the strict rules of unicode are applied (no overlong form, no surrogate, no rune above 0x10FFFF),
+	//and an invalid input is measured by maximal subparts, each of which is replaced by one U+FFFD.
+
+	//return the length of the well-formed sequence at p, or return 0 and take the length of the maximal subpart
+	static inline size_t __u8_check_seq(const uint8_t* p8, const uint8_t* end8, size_t* bad_len) {
+		uint8_t ch8 = p8[0];
+		if (ch8 <= 0x7F)
+			return 1;
+
+		size_t len8_addi;
+		uint8_t lower = 0x80, upper = 0xBF;
+		if (ch8 < 0xC2) {
+			*bad_len = 1;
+			return 0;
+		}
+		else if (ch8 <= 0xDF) {
+			len8_addi = 1;
+		}
+		else if (ch8 <= 0xEF) {
+			len8_addi = 2;
+			if (ch8 == 0xE0)
+				lower = 0xA0; //overlong
+			else if (ch8 == 0xED)
+				upper = 0x9F; //surrogate
+		}
+		else if (ch8 <= 0xF4) {
+			len8_addi = 3;
+			if (ch8 == 0xF0)
+				lower = 0x90; //overlong
+			else if (ch8 == 0xF4)
+				upper = 0x8F; //above 0x10FFFF
+		}
+		else {
+			*bad_len = 1;
+			return 0;
+		}
+
+		for (size_t i = 1; i <= len8_addi; ++i) {
+			if (p8 + i >= end8 || p8[i] < lower || p8[i] > upper) {
+				*bad_len = i;
+				return 0;
+			}
+			lower = 0x80;
+			upper = 0xBF;
+		}
+		return len8_addi + 1;
+	}
+
+	static size_t __find_u8_error_scalar(const uint8_t* p8, size_t len8, size_t pos8) {
+		while (pos8 < len8) {
+#if _KS_SIMD_SSE2
+			if (len8 - pos8 >= 16 && _mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(p8 + pos8))) == 0) {
+				pos8 += 16;
+				continue;
+			}
+#endif
+			size_t bad_len;
+			size_t seq_len = __u8_check_seq(p8 + pos8, p8 + len8, &bad_len);
+			if (seq_len == 0)
+				return pos8;
+			pos8 += seq_len;
+		}
+		return size_t(-1);
+	}
+
+#if _KS_SIMD_AVX2
+	//the lookup algorithm of keiser & lemire, validating 16 bytes with 3 nibble-table lookups
+	_KS_TARGET_AVX2
+	static inline __m128i __check_u8_block_avx2(__m128i input, __m128i prev_input) {
+		enum : uint8_t {
+			TOO_SHORT = 1 << 0, TOO_LONG = 1 << 1, OVERLONG_3 = 1 << 2, TOO_LARGE = 1 << 3,
+			SURROGATE = 1 << 4, OVERLONG_2 = 1 << 5, TOO_LARGE_1000 = 1 << 6, OVERLONG_4 = 1 << 6,
+			TWO_CONTS = 1 << 7, CARRY = TOO_SHORT | TOO_LONG | TWO_CONTS,
+		};
+		const __m128i table_1_high = _mm_setr_epi8(
+			TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+			(char)TWO_CONTS, (char)TWO_CONTS, (char)TWO_CONTS, (char)TWO_CONTS,
+			TOO_SHORT | OVERLONG_2,
+			TOO_SHORT,
+			TOO_SHORT | OVERLONG_3 | SURROGATE,
+			TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4);
+		const __m128i table_1_low = _mm_setr_epi8(
+			(char)(CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4),
+			(char)(CARRY | OVERLONG_2),
+			(char)CARRY, (char)CARRY,
+			(char)(CARRY | TOO_LARGE),
+			(char)(CARRY | TOO_LARGE | TOO_LARGE_1000), (char)(CARRY | TOO_LARGE | TOO_LARGE_1000), (char)(CARRY | TOO_LARGE | TOO_LARGE_1000),
+			(char)(CARRY | TOO_LARGE | TOO_LARGE_1000), (char)(CARRY | TOO_LARGE | TOO_LARGE_1000), (char)(CARRY | TOO_LARGE | TOO_LARGE_1000),
+			(char)(CARRY | TOO_LARGE | TOO_LARGE_1000), (char)(CARRY | TOO_LARGE | TOO_LARGE_1000),
+			(char)(CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE),
+			(char)(CARRY | TOO_LARGE | TOO_LARGE_1000), (char)(CARRY | TOO_LARGE | TOO_LARGE_1000));
+		const __m128i table_2_high = _mm_setr_epi8(
+			TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+			(char)(TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4),
+			(char)(TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE),
+			(char)(TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE),
+			(char)(TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE),
+			TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT);
+
+		const __m128i v_0f = _mm_set1_epi8(0x0F);
+		__m128i prev1 = _mm_alignr_epi8(input, prev_input, 15);
+		__m128i byte_1_high = _mm_shuffle_epi8(table_1_high, _mm_and_si128(_mm_srli_epi16(prev1, 4), v_0f));
+		__m128i byte_1_low = _mm_shuffle_epi8(table_1_low, _mm_and_si128(prev1, v_0f));
+		__m128i byte_2_high = _mm_shuffle_epi8(table_2_high, _mm_and_si128(_mm_srli_epi16(input, 4), v_0f));
+		__m128i special_cases = _mm_and_si128(_mm_and_si128(byte_1_high, byte_1_low), byte_2_high);
+
+		__m128i prev2 = _mm_alignr_epi8(input, prev_input, 14);
+		__m128i prev3 = _mm_alignr_epi8(input, prev_input, 13);
+		__m128i is_third_byte = _mm_subs_epu8(prev2, _mm_set1_epi8((char)(0xE0 - 0x80)));
+		__m128i is_fourth_byte = _mm_subs_epu8(prev3, _mm_set1_epi8((char)(0xF0 - 0x80)));
+		__m128i must23_80 = _mm_and_si128(_mm_or_si128(is_third_byte, is_fourth_byte), _mm_set1_epi8((char)0x80));
+		return _mm_xor_si128(must23_80, special_cases);
+	}
+
+	_KS_TARGET_AVX2
+	static size_t __find_u8_error_avx2(const uint8_t* p8, size_t len8) {
+		//the trailing bytes that a block leaves unfinished
+		const __m128i max_value = _mm_setr_epi8(
+			-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, (char)(0xF0 - 1), (char)(0xE0 - 1), (char)(0xC0 - 1));
+		__m128i prev_input = _mm_setzero_si128(), prev_incomplete = _mm_setzero_si128();
+		size_t pos8 = 0;
+		for (; pos8 + 16 <= len8; pos8 += 16) {
+			__m128i input = _mm_loadu_si128((const __m128i*)(p8 + pos8));
+			__m128i error;
+			if (_mm_movemask_epi8(input) == 0) {
+				error = prev_incomplete;
+				prev_incomplete = _mm_setzero_si128();
+			}
+			else {
+				error = __check_u8_block_avx2(input, prev_input);
+				prev_incomplete = _mm_subs_epu8(input, max_value);
+			}
+			if (!_mm_testz_si128(error, error))
+				break;
+			prev_input = input;
+		}
+
+		if (pos8 == len8 && _mm_testz_si128(prev_incomplete, prev_incomplete))
+			return size_t(-1);
+
+		//locate the error (or check the tail) by the scalar steps, from a sequence boundary a little before
+		size_t start8 = pos8 >= 4 ? pos8 - 4 : 0;
+		for (size_t i = 0; i < 3 && start8 < pos8 && (p8[start8] & 0xC0) == 0x80; ++i)
+			++start8;
+		_mm256_zeroupper();
+		return __find_u8_error_scalar(p8, len8, start8);
+	}
+#endif
+
+	//return the offset of the first invalid sequence, or size_t(-1)
+	static size_t __find_u8_error(const uint8_t* p8, size_t len8) {
+#if _KS_SIMD_AVX2
+		if (__simd::cpu_has_avx2())
+			return __find_u8_error_avx2(p8, len8);
+#endif
+		return __find_u8_error_scalar(p8, len8, 0);
+	}
+
+	//return the offset of the first lone surrogate, or size_t(-1)
+	static size_t __find_u16_error(const WCHAR* p, size_t len) {
+		size_t pos = 0;
+		while (pos < len) {
+#if _KS_SIMD_SSE2
+			if (len - pos >= 8) {
+				__m128i v = _mm_loadu_si128((const __m128i*)(p + pos));
+				if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(v, _mm_set1_epi16((short)0xF800)), _mm_set1_epi16((short)0xD800))) == 0) {
+					pos += 8;
+					continue;
+				}
+			}
+#endif
+			WCHAR ch = p[pos];
+			if ((ch & 0xF800) != 0xD800)
+				pos += 1;
+			else if ((ch & 0xFC00) == 0xD800 && pos + 1 < len && (p[pos + 1] & 0xFC00) == 0xDC00)
+				pos += 2;
+			else
+				return pos;
+		}
+		return size_t(-1);
+	}
+
+
+	//utf8 runes
+	//note: a rune starts at each non-continuation byte in the well-formed utf8, so the counting needs no decoding.
+
+	static size_t __count_u8_runes_of_valid(const uint8_t* p8, size_t len8) {
+		size_t rune_count = 0;
+		size_t pos8 = 0;
+#if _KS_SIMD_SSE2
+		const __m128i v_C0 = _mm_set1_epi8((char)0xC0);
+		while (len8 - pos8 >= 16) {
+			//the byte counters are folded every 255 rounds at most, before they overflow
+			size_t rounds = (std::min)((len8 - pos8) / 16, size_t(255));
+			__m128i v_cont_count = _mm_setzero_si128();
+			for (size_t i = 0; i < rounds; ++i, pos8 += 16) {
+				__m128i v = _mm_loadu_si128((const __m128i*)(p8 + pos8));
+				v_cont_count = _mm_sub_epi8(v_cont_count, _mm_cmplt_epi8(v, v_C0)); //signed compare, true for 0x80~0xBF only
+			}
+			__m128i v_sum = _mm_sad_epu8(v_cont_count, _mm_setzero_si128());
+			size_t cont_count = (size_t)_mm_cvtsi128_si32(v_sum) + (size_t)_mm_cvtsi128_si32(_mm_srli_si128(v_sum, 8));
+			rune_count += rounds * 16 - cont_count;
+		}
+#endif
+		for (; pos8 < len8; ++pos8) {
+			if ((p8[pos8] & 0xC0) != 0x80)
+				++rune_count;
+		}
+		return rune_count;
+	}
+
+	static size_t __offset_of_u8_rune_of_valid(const uint8_t* p8, size_t len8, size_t rune_index) {
+		size_t pos8 = 0;
+#if _KS_SIMD_SSE2
+		const __m128i v_C0 = _mm_set1_epi8((char)0xC0);
+		while (len8 - pos8 >= 16) {
+			__m128i v = _mm_loadu_si128((const __m128i*)(p8 + pos8));
+			size_t block_rune_count = 16 - __simd::popcount32((uint32_t)_mm_movemask_epi8(_mm_cmplt_epi8(v, v_C0)));
+			if (rune_index < block_rune_count)
+				break;
+			rune_index -= block_rune_count;
+			pos8 += 16;
+		}
+#endif
+		for (; pos8 < len8; ++pos8) {
+			if ((p8[pos8] & 0xC0) != 0x80) {
+				if (rune_index == 0)
+					return pos8;
+				--rune_index;
+			}
+		}
+		return len8;
+	}
+
+
+	//utf16 runes
+	//note: a surrogate pair makes one rune, and a lone surrogate is taken as a rune by itself.
+
+	static inline const WCHAR* __decode_u16_rune_step(const WCHAR* p, const WCHAR* end, uint32_t*& p32) {
+		uint ch = p[0];
+		if ((ch & 0xFC00) == 0xD800 && p + 1 < end && (uint(p[1]) & 0xFC00) == 0xDC00) {
+			*(p32++) = 0x10000 + (((ch & 0x3FF) << 10) | (uint(p[1]) & 0x3FF));
+			return p + 2;
+		}
+		*(p32++) = ch;
+		return p + 1;
+	}
+
+	static uint32_t* __decode_u16_runes_scalar(const WCHAR* p, const WCHAR* end, uint32_t* p32) {
+		while (p < end)
+			p = __decode_u16_rune_step(p, end, p32);
+		return p32;
+	}
+
+#if _KS_SIMD_SSE2
+	//combine 4 surrogate pairs of 8 units to 4 runes, return false if the units are not exactly 4 pairs
+	static inline bool __decode_u16_4pairs_sse2(const WCHAR* p, uint32_t* p32) {
+		__m128i v = _mm_loadu_si128((const __m128i*)p);
+		__m128i v_expected = _mm_set1_epi32((int)0xDC00D800);
+		if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(v, _mm_set1_epi16((short)0xFC00)), v_expected)) != 0xFFFF)
+			return false;
+
+		//rune = 0x10000 + ((hi & 0x3FF) << 10) + (lo & 0x3FF), where hi is the low half of each 32-bit lane
+		__m128i v_hi = _mm_and_si128(v, _mm_set1_epi32(0x3FF));
+		__m128i v_lo = _mm_and_si128(_mm_srli_epi32(v, 16), _mm_set1_epi32(0x3FF));
+		__m128i v_rune = _mm_add_epi32(_mm_or_si128(_mm_slli_epi32(v_hi, 10), v_lo), _mm_set1_epi32(0x10000));
+		_mm_storeu_si128((__m128i*)p32, v_rune);
+		return true;
+	}
+
+	static uint32_t* __decode_u16_runes_sse2(const WCHAR* p, const WCHAR* end, uint32_t* p32) {
+		const __m128i v_F800 = _mm_set1_epi16((short)0xF800);
+		const __m128i v_D800 = _mm_set1_epi16((short)0xD800);
+		while (end - p >= 8) {
+			__m128i v = _mm_loadu_si128((const __m128i*)p);
+			if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(v, v_F800), v_D800)) == 0) {
+				_mm_storeu_si128((__m128i*)p32, _mm_unpacklo_epi16(v, _mm_setzero_si128()));
+				_mm_storeu_si128((__m128i*)(p32 + 4), _mm_unpackhi_epi16(v, _mm_setzero_si128()));
+				p += 8;
+				p32 += 8;
+			}
+			else if (__decode_u16_4pairs_sse2(p, p32)) {
+				p += 8;
+				p32 += 4;
+			}
+			else {
+				//the block with surrogates is done by scalar, the pair crossing the block end is taken whole
+				const WCHAR* block_end = p + 8;
+				while (p < block_end)
+					p = __decode_u16_rune_step(p, end, p32);
+			}
+		}
+		return __decode_u16_runes_scalar(p, end, p32);
+	}
+#endif
+
+#if _KS_SIMD_AVX2
+	_KS_TARGET_AVX2
+	static uint32_t* __decode_u16_runes_avx2(const WCHAR* p, const WCHAR* end, uint32_t* p32) {
+		const __m256i v_F800 = _mm256_set1_epi16((short)0xF800);
+		const __m256i v_D800 = _mm256_set1_epi16((short)0xD800);
+		while (end - p >= 16) {
+			__m256i v = _mm256_loadu_si256((const __m256i*)p);
+			if (_mm256_movemask_epi8(_mm256_cmpeq_epi16(_mm256_and_si256(v, v_F800), v_D800)) == 0) {
+				_mm256_storeu_si256((__m256i*)p32, _mm256_cvtepu16_epi32(_mm256_castsi256_si128(v)));
+				_mm256_storeu_si256((__m256i*)(p32 + 8), _mm256_cvtepu16_epi32(_mm256_extracti128_si256(v, 1)));
+				p += 16;
+				p32 += 16;
+			}
+			else if (__decode_u16_4pairs_sse2(p, p32)) {
+				p += 8;
+				p32 += 4;
+			}
+			else {
+				const WCHAR* block_end = p + 16;
+				while (p < block_end)
+					p = __decode_u16_rune_step(p, end, p32);
+			}
+		}
+		_mm256_zeroupper();
+		return __decode_u16_runes_sse2(p, end, p32);
+	}
+#endif
+
+	static uint32_t* __decode_u16_runes(const WCHAR* p, const WCHAR* end, uint32_t* p32) {
+#if _KS_SIMD_AVX2
+		if (__simd::cpu_has_avx2())
+			return __decode_u16_runes_avx2(p, end, p32);
+#endif
+#if _KS_SIMD_SSE2
+		return __decode_u16_runes_sse2(p, end, p32);
+#else
+		return __decode_u16_runes_scalar(p, end, p32);
+#endif
+	}
+
+	//return the count of runes decoded by __decode_u16_runes, that is the length minus the count of surrogate pairs
+	static size_t __count_runes_of_u16(const WCHAR* p, size_t len) {
+		size_t pair_count = 0;
+		size_t pos = 0;
+#if _KS_SIMD_SSE2
+		const __m128i v_FC00 = _mm_set1_epi16((short)0xFC00);
+		while (len - pos >= 9) {
+			//a pair is counted at its high surrogate, so the pairs are never counted twice
+			__m128i v = _mm_loadu_si128((const __m128i*)(p + pos));
+			__m128i v_next = _mm_loadu_si128((const __m128i*)(p + pos + 1));
+			__m128i v_is_pair = _mm_and_si128(
+				_mm_cmpeq_epi16(_mm_and_si128(v, v_FC00), _mm_set1_epi16((short)0xD800)),
+				_mm_cmpeq_epi16(_mm_and_si128(v_next, v_FC00), _mm_set1_epi16((short)0xDC00)));
+			uint32_t mask = (uint32_t)_mm_movemask_epi8(v_is_pair);
+			if (mask != 0)
+				pair_count += __simd::popcount32(mask) / 2;
+			pos += 8;
+		}
+#endif
+		for (; pos + 1 < len; ++pos) {
+			if ((p[pos] & 0xFC00) == 0xD800 && (p[pos + 1] & 0xFC00) == 0xDC00)
+				++pair_count;
+		}
+		return len - pair_count;
+	}
+
+
+	//utf32 to utf16
+	//note: a rune above 0xFFFF is expanded to a surrogate pair, and the others are narrowed as they are.
+
+	static inline void __encode_u32_step(uint rune, WCHAR*& p16) {
+		if (rune < 0x10000) {
+			*(p16++) = (WCHAR)rune;
+		}
+		else {
+			rune -= 0x10000;
+			ASSERT((rune & ~0xFFFFF) == 0);
+			*(p16++) = (WCHAR)(0xD800 | ((rune & 0xFFC00) >> 10));
+			*(p16++) = (WCHAR)(0xDC00 | ((rune & 0x003FF)));
+		}
+	}
+
+	//the branchless version, which writes one more unit for a rune not above 0xFFFF, so it must not be the last rune
+	static inline void __encode_u32_step_not_last(uint rune, WCHAR*& p16) {
+		const uint rune_sub = rune - 0x10000;
+		const bool is_pair = rune >= 0x10000;
+		p16[0] = (WCHAR)(is_pair ? (0xD800 | ((rune_sub & 0xFFC00) >> 10)) : rune);
+		p16[1] = (WCHAR)(0xDC00 | (rune_sub & 0x003FF));
+		p16 += is_pair ? 2 : 1;
+	}
+
+	static size_t __count_u16_of_u32(const uint32_t* p32, size_t len32) {
+		size_t wch_count = len32;
+		size_t pos32 = 0;
+#if _KS_SIMD_SSE2
+		while (len32 - pos32 >= 4) {
+			__m128i v = _mm_loadu_si128((const __m128i*)(p32 + pos32));
+			__m128i v_is_bmp = _mm_cmpeq_epi32(_mm_srli_epi32(v, 16), _mm_setzero_si128());
+			wch_count += 4 - __simd::popcount32((uint32_t)_mm_movemask_ps(_mm_castsi128_ps(v_is_bmp)));
+			pos32 += 4;
+		}
+#endif
+		for (; pos32 < len32; ++pos32) {
+			if (p32[pos32] >= 0x10000)
+				++wch_count;
+		}
+		return wch_count;
+	}
+
+#if _KS_SIMD_SSE2
+	//expand 4 runes all above 0xFFFF to 4 pairs: (hi | lo << 16) in each lane, return false if any rune is not
+	static inline bool __encode_u32_4pairs_sse2(const uint32_t* p32, WCHAR* p16) {
+		__m128i v = _mm_loadu_si128((const __m128i*)p32);
+		if (_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(v, _mm_set1_epi32(0xFFFF)))) != 0xF
+			|| _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(v, _mm_set1_epi32(0x10FFFF)))) != 0)
+			return false;
+
+		__m128i v_sub = _mm_sub_epi32(v, _mm_set1_epi32(0x10000));
+		__m128i v_hi = _mm_or_si128(_mm_srli_epi32(v_sub, 10), _mm_set1_epi32(0xD800));
+		__m128i v_lo = _mm_or_si128(_mm_and_si128(v_sub, _mm_set1_epi32(0x3FF)), _mm_set1_epi32(0xDC00));
+		_mm_storeu_si128((__m128i*)p16, _mm_or_si128(v_hi, _mm_slli_epi32(v_lo, 16)));
+		return true;
+	}
+
+	static WCHAR* __encode_u32_sse2(const uint32_t* p32, const uint32_t* end32, WCHAR* p16) {
+		while (end32 - p32 >= 8) {
+			__m128i v0 = _mm_loadu_si128((const __m128i*)p32);
+			__m128i v1 = _mm_loadu_si128((const __m128i*)(p32 + 4));
+			if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_srli_epi32(_mm_or_si128(v0, v1), 16), _mm_setzero_si128())) == 0xFFFF) {
+				//sign-extend the low halves first, so that the saturation of packs never happens
+				__m128i w0 = _mm_srai_epi32(_mm_slli_epi32(v0, 16), 16);
+				__m128i w1 = _mm_srai_epi32(_mm_slli_epi32(v1, 16), 16);
+				_mm_storeu_si128((__m128i*)p16, _mm_packs_epi32(w0, w1));
+				p32 += 8;
+				p16 += 8;
+				continue;
+			}
+
+			if (__encode_u32_4pairs_sse2(p32, p16)) {
+				p32 += 4;
+				p16 += 8;
+				continue;
+			}
+
+			for (int i = 0; i < 4; ++i)
+				__encode_u32_step_not_last(*(p32++), p16);
+		}
+
+		while (p32 < end32)
+			__encode_u32_step(*(p32++), p16);
+		return p16;
+	}
+#endif
+
+#if _KS_SIMD_AVX2
+	_KS_TARGET_AVX2
+	static WCHAR* __encode_u32_avx2(const uint32_t* p32, const uint32_t* end32, WCHAR* p16) {
+		const __m256i v_FFFF = _mm256_set1_epi32(0xFFFF);
+		const __m256i v_10FFFF = _mm256_set1_epi32(0x10FFFF);
+		const __m256i v_3FF = _mm256_set1_epi32(0x3FF);
+		const __m256i v_DC00D800 = _mm256_set1_epi32((int)0xDC00D800);
+		while (end32 - p32 >= 16) {
+			__m256i v0 = _mm256_loadu_si256((const __m256i*)p32);
+			__m256i v1 = _mm256_loadu_si256((const __m256i*)(p32 + 8));
+			if (_mm256_testz_si256(_mm256_or_si256(v0, v1), _mm256_set1_epi32((int)0xFFFF0000))) {
+				//packus works in 128-bit lanes, so the 64-bit blocks are reordered after packing
+				__m256i v_packed = _mm256_packus_epi32(v0, v1);
+				_mm256_storeu_si256((__m256i*)p16, _mm256_permute4x64_epi64(v_packed, 0xD8));
+				p32 += 16;
+				p16 += 16;
+			}
+			else if (_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpgt_epi32(v0, v_FFFF), _mm256_cmpgt_epi32(v1, v_FFFF))) == -1
+				&& _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpgt_epi32(v0, v_10FFFF), _mm256_cmpgt_epi32(v1, v_10FFFF))) == 0) {
+				//16 runes all above 0xFFFF are expanded to 16 pairs: (hi | lo << 16) in each lane
+				__m256i v_sub0 = _mm256_sub_epi32(v0, _mm256_set1_epi32(0x10000));
+				__m256i v_sub1 = _mm256_sub_epi32(v1, _mm256_set1_epi32(0x10000));
+				__m256i v_pair0 = _mm256_or_si256(_mm256_or_si256(_mm256_srli_epi32(v_sub0, 10), _mm256_slli_epi32(_mm256_and_si256(v_sub0, v_3FF), 16)), v_DC00D800);
+				__m256i v_pair1 = _mm256_or_si256(_mm256_or_si256(_mm256_srli_epi32(v_sub1, 10), _mm256_slli_epi32(_mm256_and_si256(v_sub1, v_3FF), 16)), v_DC00D800);
+				_mm256_storeu_si256((__m256i*)p16, v_pair0);
+				_mm256_storeu_si256((__m256i*)(p16 + 16), v_pair1);
+				p32 += 16;
+				p16 += 32;
+			}
+			else {
+				//the mixed runes are done by halves, with the branchless step, but the last one may be the last of all
+				for (int half = 0; half < 2; ++half) {
+					__m256i v = half == 0 ? v0 : v1;
+					if (_mm256_testz_si256(v, _mm256_set1_epi32((int)0xFFFF0000))) {
+						_mm_storeu_si128((__m128i*)p16, _mm_packus_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1)));
+						p32 += 8;
+						p16 += 8;
+						continue;
+					}
+					for (int i = 0; i < 7; ++i)
+						__encode_u32_step_not_last(*(p32++), p16);
+					if (half == 0)
+						__encode_u32_step_not_last(*(p32++), p16);
+					else
+						__encode_u32_step(*(p32++), p16);
+				}
+			}
+		}
+		_mm256_zeroupper();
+		return __encode_u32_sse2(p32, end32, p16);
+	}
+#endif
+
+	//the space of p16 must be enough (measured by __count_u16_of_u32)
+	static WCHAR* __encode_u32(const uint32_t* p32, const uint32_t* end32, WCHAR* p16) {
+#if _KS_SIMD_AVX2
+		if (__simd::cpu_has_avx2())
+			return __encode_u32_avx2(p32, end32, p16);
+#endif
+#if _KS_SIMD_SSE2
+		return __encode_u32_sse2(p32, end32, p16);
+#else
+		while (p32 < end32)
+			__encode_u32_step(*(p32++), p16);
+		return p16;
+#endif
+	}
+
+
+	//ascii/latin1
+	//note: the probes accumulate 64 bytes by OR before testing, so the pure input is passed at the memory speed.
+
+	static bool __is_all_ascii8(const uint8_t* p8, size_t len8) {
+		size_t pos8 = 0;
+#if _KS_SIMD_SSE2
+		for (; len8 - pos8 >= 64; pos8 += 64) {
+			__m128i v_or = _mm_or_si128(
+				_mm_or_si128(_mm_loadu_si128((const __m128i*)(p8 + pos8)), _mm_loadu_si128((const __m128i*)(p8 + pos8 + 16))),
+				_mm_or_si128(_mm_loadu_si128((const __m128i*)(p8 + pos8 + 32)), _mm_loadu_si128((const __m128i*)(p8 + pos8 + 48))));
+			if (_mm_movemask_epi8(v_or) != 0)
+				return false;
+		}
+		for (; len8 - pos8 >= 16; pos8 += 16) {
+			if (_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(p8 + pos8))) != 0)
+				return false;
+		}
+#endif
+		for (; pos8 < len8; ++pos8) {
+			if (p8[pos8] >= 0x80)
+				return false;
+		}
+		return true;
+	}
+
+	//check if no unit has any bit of high_mask
+	static bool __is_all_units_under_mask(const WCHAR* p, size_t len, WCHAR high_mask) {
+		size_t pos = 0;
+#if _KS_SIMD_SSE2
+		const __m128i v_mask = _mm_set1_epi16((short)high_mask);
+		for (; len - pos >= 32; pos += 32) {
+			__m128i v_or = _mm_or_si128(
+				_mm_or_si128(_mm_loadu_si128((const __m128i*)(p + pos)), _mm_loadu_si128((const __m128i*)(p + pos + 8))),
+				_mm_or_si128(_mm_loadu_si128((const __m128i*)(p + pos + 16)), _mm_loadu_si128((const __m128i*)(p + pos + 24))));
+			if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(v_or, v_mask), _mm_setzero_si128())) != 0xFFFF)
+				return false;
+		}
+		for (; len - pos >= 8; pos += 8) {
+			__m128i v = _mm_loadu_si128((const __m128i*)(p + pos));
+			if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(v, v_mask), _mm_setzero_si128())) != 0xFFFF)
+				return false;
+		}
+#endif
+		for (; pos < len; ++pos) {
+			if ((p[pos] & high_mask) != 0)
+				return false;
+		}
+		return true;
+	}
+
+	static void __widen_latin1(const uint8_t* p8, size_t len8, WCHAR* p16) {
+		size_t pos8 = 0;
+#if _KS_SIMD_SSE2
+		for (; len8 - pos8 >= 16; pos8 += 16) {
+			__m128i v = _mm_loadu_si128((const __m128i*)(p8 + pos8));
+			_mm_storeu_si128((__m128i*)(p16 + pos8), _mm_unpacklo_epi8(v, _mm_setzero_si128()));
+			_mm_storeu_si128((__m128i*)(p16 + pos8 + 8), _mm_unpackhi_epi8(v, _mm_setzero_si128()));
+		}
+#endif
+		for (; pos8 < len8; ++pos8)
+			p16[pos8] = (WCHAR)p8[pos8];
+	}
+
+	static bool __narrow_latin1(const WCHAR* p, size_t len, uint8_t* p8) {
+		size_t pos = 0;
+#if _KS_SIMD_SSE2
+		const __m128i v_FF00 = _mm_set1_epi16((short)0xFF00);
+		for (; len - pos >= 16; pos += 16) {
+			__m128i v0 = _mm_loadu_si128((const __m128i*)(p + pos));
+			__m128i v1 = _mm_loadu_si128((const __m128i*)(p + pos + 8));
+			if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(_mm_or_si128(v0, v1), v_FF00), _mm_setzero_si128())) != 0xFFFF)
+				return false;
+			_mm_storeu_si128((__m128i*)(p8 + pos), _mm_packus_epi16(v0, v1));
+		}
+#endif
+		for (; pos < len; ++pos) {
+			if (p[pos] > 0xFF)
+				return false;
+			p8[pos] = (uint8_t)p[pos];
+		}
+		return true;
+	}
+
+
+	//append the converted to the output by the policy, return the offset of the first error, or size_t(-1)
+	static size_t __append_u8_decoded(ks_mutable_wstring& wstr, const uint8_t* p8, size_t len8, utf_error_policy policy) {
+		if (len8 == 0)
+			return size_t(-1);
+
+		const size_t first_err_pos8 = __find_u8_error(p8, len8);
+		size_t err_pos8 = first_err_pos8;
+
+		//the exact count for the valid part, otherwise the input length as the bound (every byte produces one unit at most)
+		const size_t wch_bound = (err_pos8 == size_t(-1) || policy == utf_error_policy::stop)
+			? __count_u16_of_u8(p8, err_pos8 != size_t(-1) ? err_pos8 : len8)
+			: len8;
+		const size_t old_length = wstr.length();
+		WCHAR* wstr_data = wstr.__begin_exclusive_writing(old_length + wch_bound);
+		WCHAR* const wstr_end = wstr_data + old_length + wch_bound;
+		WCHAR* wstr_data_p = wstr_data + old_length;
+		size_t pos8 = 0;
+		while (true) {
+			const size_t valid_end8 = err_pos8 != size_t(-1) ? err_pos8 : len8;
+			wstr_data_p = __decode_u8(p8 + pos8, p8 + valid_end8, wstr_data_p, wstr_end);
+			if (err_pos8 == size_t(-1) || policy == utf_error_policy::stop)
+				break;
+
+			size_t bad_len8 = 0;
+			__u8_check_seq(p8 + err_pos8, p8 + len8, &bad_len8);
+			if (policy == utf_error_policy::replace)
+				*(wstr_data_p++) = (WCHAR)(0xFFFD);
+
+			pos8 = err_pos8 + bad_len8;
+			err_pos8 = __find_u8_error(p8 + pos8, len8 - pos8);
+			if (err_pos8 != size_t(-1))
+				err_pos8 += pos8;
+		}
+
+		wstr.__end_exclusive_writing(wstr_data, wstr_data_p - wstr_data);
+		return first_err_pos8;
+	}
+
+	static size_t __append_u16_encoded(ks_mutable_string& str8, const WCHAR* p, size_t len, utf_error_policy policy) {
+		if (len == 0)
+			return size_t(-1);
+
+		const size_t first_err_pos = __find_u16_error(p, len);
+		size_t err_pos = first_err_pos;
+
+		//the exact count for the valid part, otherwise 3 times of the input length as the bound (both a lone surrogate and its U+FFFD take 3 bytes at most)
+		const size_t char8_bound = (err_pos == size_t(-1) || policy == utf_error_policy::stop)
+			? __count_u8_of_u16(p, err_pos != size_t(-1) ? err_pos : len)
+			: len * 3;
+		const size_t old_length = str8.length();
+		char* str8_data = str8.__begin_exclusive_writing(old_length + char8_bound);
+		uint8_t* const str8_end = (uint8_t*)str8_data + old_length + char8_bound;
+		uint8_t* str8_data_p = (uint8_t*)str8_data + old_length;
+		size_t pos = 0;
+		while (true) {
+			const size_t valid_end = err_pos != size_t(-1) ? err_pos : len;
+			str8_data_p = __encode_u16(p + pos, p + valid_end, str8_data_p, str8_end);
+			if (err_pos == size_t(-1) || policy == utf_error_policy::stop)
+				break;
+
+			if (policy == utf_error_policy::replace) {
+				*(str8_data_p++) = 0xEF;
+				*(str8_data_p++) = 0xBF;
+				*(str8_data_p++) = 0xBD;
+			}
+
+			pos = err_pos + 1;
+			err_pos = __find_u16_error(p + pos, len - pos);
+			if (err_pos != size_t(-1))
+				err_pos += pos;
+		}
+
+		str8.__end_exclusive_writing(str8_data, (char*)str8_data_p - str8_data);
+		return first_err_pos;
+	}
+
+
+	//native conversion
+	//note: the conversion is resolved from the current locale (or the ansi code page) once, and then cached per thread,
+	//until refresh_native_conversion() is called (after the locale is changed).
+#ifndef _WIN32
+	struct __codecvt_by_loc_t : std::codecvt_byname<wchar_t, char, std::mbstate_t> { using std::codecvt_byname<wchar_t, char, std::mbstate_t>::codecvt_byname; };
+	using __std_converter_t = std::wstring_convert<__codecvt_by_loc_t, wchar_t>;
+	using __std_converter_ks_t = std::wstring_convert<__codecvt_by_loc_t, wchar_t, ks_basic_string_allocator<wchar_t>>;
+#endif
+
+	struct __native_conversion {
+		uint generation = 0;
+		bool is_utf8 = false;
+#ifdef _WIN32
+		UINT acp = 0;
+#else
+		std::string loc_name;
+		std::unique_ptr<__std_converter_t> std_converter; //created on demand
+		std::unique_ptr<__std_converter_ks_t> std_converter_ks; //created on demand
+#endif
+	};
+
+	static std::atomic<uint> g_native_conversion_generation(1);
+
+	static __native_conversion& __get_native_conversion() {
+		static thread_local __native_conversion t_native_conv;
+		const uint generation = g_native_conversion_generation.load(std::memory_order_acquire);
+		if (t_native_conv.generation == generation)
+			return t_native_conv;
+
+#ifdef _WIN32
+		UINT acp = ::GetACP();
+		if (acp == 936 || acp == 20936)
+			acp = 54936; //auto promote GBK or GB2312 to GB18030
+		t_native_conv.acp = acp;
+		t_native_conv.is_utf8 = acp == 65001;
+#else
+		const char* loc_name = std::setlocale(LC_ALL, nullptr);
+		std::string loc_name_str(loc_name != nullptr ? loc_name : "");
+		std::string loc_name_str_up(loc_name_str);
+		for (auto& c : loc_name_str_up)
+			c = (char)toupper(c);
+
+		t_native_conv.is_utf8 = loc_name_str_up.empty() || loc_name_str_up == "C" || loc_name_str_up == "POSIX" ||
+			ks_string_view(loc_name_str_up).ends_with(".UTF-8") || ks_string_view(loc_name_str_up).ends_with(".UTF8");
+		t_native_conv.loc_name = std::move(loc_name_str);
+		t_native_conv.std_converter.reset();
+		t_native_conv.std_converter_ks.reset();
+#endif
+
+		t_native_conv.generation = generation;
+		return t_native_conv;
+	}
+
+
 	//convert from ...
 	MODERN_STRING_API
 	ks_immutable_wstring wstring_from_u8_chars(const char8_t* p, size_t len) {
@@ -40,93 +1375,45 @@ namespace ks_string_util {
 		//std::basic_string<char16_t> std_str16 = std_converter.from_bytes(str_view.data(), str_view.data() + str_view.length());
 		//return wstring_from_u16_chars(std_str16.data(), std_str16.length());
 
-		size_t wch_count = str_length8;
-		for (size_t pos8 = 0; pos8 < str_length8; ) {
-			uint8_t ch8 = str_data8[pos8++];
-			if (ch8 <= 0xBF) {
-				//0xxxxxxx
-				//10xxxxxx (invalid)
-				ASSERT(ch8 <= 0x7F);
-			}
-			else if (ch8 <= 0xDF) {
-				//110xxxxx 10xxxxxx
-				ASSERT(pos8 + 0 < str_length8 && (ch8 & 0xE0) == 0xC0 && (str_data8[pos8 + 0] & 0xC0) == 0x80);
-				size_t len8_addi = (std::min)(size_t(1), str_length8 - pos8);
-				wch_count -= len8_addi;
-				pos8 += len8_addi;
-			}
-			else if (ch8 <= 0xEF) {
-				//1110xxxx 10xxxxxx 10xxxxxx
-				ASSERT(pos8 + 1 < str_length8 && (ch8 & 0xF0) == 0xE0 && (str_data8[pos8 + 0] & 0xC0) == 0x80 && (str_data8[pos8 + 1] & 0xC0) == 0x80);
-				size_t len8_addi = (std::min)(size_t(2), str_length8 - pos8);
-				wch_count -= len8_addi;
-				pos8 += len8_addi;
-			}
-			else if (ch8 <= 0xF7) {
-				//11110xxx 10xxxxxx 10xxxxxx 10xxxxxx
-				ASSERT(pos8 + 2 < str_length8 && (ch8 & 0xF8) == 0xF0 && (str_data8[pos8 + 0] & 0xC0) == 0x80 && (str_data8[pos8 + 1] & 0xC0) == 0x80 && (str_data8[pos8 + 2] & 0xC0) == 0x80);
-				size_t len8_addi = (std::min)(size_t(3), str_length8 - pos8);
-				wch_count -= len8_addi;
-				wch_count += 1; //因为rune >= 0x10000
-				pos8 += len8_addi;
-			}
-			else {
-				//11111xxx (invalid)
-				ASSERT(false);
-			}
-		}
+		size_t wch_count = __count_u16_of_u8(str_data8, str_length8);
 
 		ks_mutable_wstring wstr;
 		WCHAR* wstr_data = wstr.__begin_exclusive_writing(wch_count);
-		WCHAR* wstr_data_p = wstr_data;
-		for (size_t pos8 = 0; pos8 < str_length8; ) {
-			uint8_t ch8 = str_data8[pos8++];
-			if (ch8 <= 0xBF) {
-				//0xxxxxxx
-				//10xxxxxx (invalid)
-				ASSERT(ch8 <= 0x7F);
-				*(wstr_data_p++) = (WCHAR)(ch8);
-			}
-			else if (ch8 <= 0xDF) {
-				//110xxxxx 10xxxxxx
-				uint8_t ch8_addi = pos8 < str_length8 ? str_data8[pos8++] : 0;
-				uint rune = ((uint(ch8) & 0x01F) << 6) + ((uint(ch8_addi) & 0x3F));
-				*(wstr_data_p++) = (WCHAR)(rune);
-			}
-			else if (ch8 <= 0xEF) {
-				//1110xxxx 10xxxxxx 10xxxxxx
-				uint8_t ch8_addi_arr[2] = { 0, 0 };
-				size_t len8_addi = (std::min)(size_t(2), str_length8 - pos8);
-				std::copy_n(str_data8 + pos8, len8_addi, ch8_addi_arr);
-				pos8 += len8_addi;
-				uint rune = ((uint(ch8) & 0x0F) << 12) + ((uint(ch8_addi_arr[0]) & 0x3F) << 6) + ((uint(ch8_addi_arr[1]) & 0x3F));
-				*(wstr_data_p++) = (WCHAR)(rune);
-			}
-			else if (ch8 <= 0xF7) {
-				//11110xxx 10xxxxxx 10xxxxxx 10xxxxxx
-				uint8_t ch8_addi_arr[3] = { 0, 0, 0 };
-				size_t len8_addi = (std::min)(size_t(3), str_length8 - pos8);
-				std::copy_n(str_data8 + pos8, len8_addi, ch8_addi_arr);
-				pos8 += len8_addi;
-				uint rune = ((uint(ch8) & 0x07) << 18) + ((uint(ch8_addi_arr[0]) & 0x3F) << 12) + ((uint(ch8_addi_arr[1]) & 0x3F) << 6) + ((uint(ch8_addi_arr[2]) & 0x3F));
-				ASSERT(rune >= 0x10000);
-				rune -= 0x10000;
-				ASSERT((rune & ~0xFFFFF) == 0);
-				*(wstr_data_p++) = (WCHAR)(0xD800 | ((rune & 0xFFC00) >> 10));
-				*(wstr_data_p++) = (WCHAR)(0xDC00 | ((rune & 0x003FF)));
-			}
-			else {
-				//11111xxx (invalid)
-				ASSERT(false);
-				*(wstr_data_p++) = (WCHAR)(ch8);
-			}
-		}
+		WCHAR* wstr_data_p = __decode_u8(str_data8, str_data8 + str_length8, wstr_data, wstr_data + wch_count);
 
 		ASSERT(wstr_data_p == wstr_data + wch_count);
 		wstr.__end_exclusive_writing(wstr_data, wstr_data_p - wstr_data);
 		return std::move(wstr);
 	}
 
+	MODERN_STRING_API
+	ks_immutable_wstring wstring_from_u8_chars(const char8_t* p, size_t len, utf_error_policy policy, size_t* error_pos) {
+		ks_basic_string_view<uint8_t> str_view8((const uint8_t*)p, len);
+		ks_mutable_wstring wstr;
+		size_t err_pos8 = __append_u8_decoded(wstr, str_view8.data(), str_view8.length(), policy);
+		if (error_pos != nullptr)
+			*error_pos = err_pos8;
+		return std::move(wstr);
+	}
+
+	MODERN_STRING_API
+	size_t wstring_from_u8_chars(const char8_t* p, size_t len, WCHAR* dst, size_t dst_capacity) {
+		ks_basic_string_view<uint8_t> str_view8((const uint8_t*)p, len);
+		if (str_view8.empty())
+			return 0;
+
+		const uint8_t* const str_data8 = str_view8.data();
+		const size_t str_length8 = str_view8.length();
+
+		size_t wch_count = __count_u16_of_u8(str_data8, str_length8);
+		if (wch_count > dst_capacity)
+			throw std::out_of_range("ks_string_util::wstring_from_u8_chars(p, len, dst, dst_capacity) out-of-range exception");
+
+		WCHAR* dst_p = __decode_u8(str_data8, str_data8 + str_length8, dst, dst + wch_count);
+		ASSERT(dst_p == dst + wch_count);
+		return dst_p - dst;
+	}
+
 	MODERN_STRING_API
 	ks_immutable_wstring wstring_from_u16_chars(const char16_t* p, size_t len) {
 		return ks_immutable_wstring((const WCHAR*)p, len);
@@ -138,44 +1425,53 @@ namespace ks_string_util {
 		if (str_view32.empty())
 			return ks_immutable_wstring();
 
-		size_t wch_count = str_view32.length();
-		wch_count += std::count_if(str_view32.cbegin(), str_view32.cend(), [](uint rune) { return rune >= 0x10000; });
+		size_t wch_count = __count_u16_of_u32(str_view32.data(), str_view32.length());
 
 		ks_mutable_wstring wstr;
 		WCHAR* wstr_data = wstr.__begin_exclusive_writing(wch_count);
-		WCHAR* wstr_data_p = wstr_data;
-		for (uint rune : str_view32) {
-			if (rune < 0x10000) {
-				*(wstr_data_p++) = (WCHAR)rune;
-			}
-			else {
-				rune -= 0x10000;
-				ASSERT((rune & ~0xFFFFF) == 0);
-				*(wstr_data_p++) = (WCHAR)(0xD800 | ((rune & 0xFFC00) >> 10));
-				*(wstr_data_p++) = (WCHAR)(0xDC00 | ((rune & 0x003FF)));
-			}
-		}
+		WCHAR* wstr_data_p = __encode_u32(str_view32.data(), str_view32.data() + str_view32.length(), wstr_data);
 
 		ASSERT(wstr_data_p == wstr_data + wch_count);
 		wstr.__end_exclusive_writing(wstr_data, wstr_data_p - wstr_data);
 		return std::move(wstr);
 	}
 
+	MODERN_STRING_API
+	ks_immutable_wstring wstring_from_latin1_chars(const char* p, size_t len) {
+		ks_basic_string_view<uint8_t> str_view8((const uint8_t*)p, len);
+		if (str_view8.empty())
+			return ks_immutable_wstring();
+
+		ks_mutable_wstring wstr;
+		WCHAR* wstr_data = wstr.__begin_exclusive_writing(str_view8.length());
+		__widen_latin1(str_view8.data(), str_view8.length(), wstr_data);
+		wstr.__end_exclusive_writing(wstr_data, str_view8.length());
+		return std::move(wstr);
+	}
+
+	MODERN_STRING_API
+	size_t wstring_from_latin1_chars(const char* p, size_t len, WCHAR* dst, size_t dst_capacity) {
+		ks_basic_string_view<uint8_t> str_view8((const uint8_t*)p, len);
+		if (str_view8.length() > dst_capacity)
+			throw std::out_of_range("ks_string_util::wstring_from_latin1_chars(p, len, dst, dst_capacity) out-of-range exception");
+
+		__widen_latin1(str_view8.data(), str_view8.length(), dst);
+		return str_view8.length();
+	}
+
 	MODERN_STRING_API
 	ks_immutable_wstring wstring_from_native_chars(const char* p, size_t len) {
 		ks_basic_string_view<char> str_view(p, len);
 		if (str_view.empty())
 			return ks_immutable_wstring();
 
-#ifdef _WIN32
-		UINT acp = ::GetACP();
-		if (acp == 65001) {
+		__native_conversion& native_conv = __get_native_conversion();
+		if (native_conv.is_utf8) {
 			return wstring_from_u8_chars((const char8_t*)p, len);
 		}
 
-		if (acp == 936 || acp == 20936)
-			acp = 54936; //auto promote GBK or GB2312 to GB18030
-
+#ifdef _WIN32
+		const UINT acp = native_conv.acp;
 		int wch_count = ::MultiByteToWideChar(acp, 0, str_view.data(), (int)str_view.length(), NULL, 0);
 		ASSERT(wch_count > 0);
 		if (wch_count <= 0) 
@@ -188,28 +1484,16 @@ namespace ks_string_util {
 		return std::move(wstr);
 
 #else
-		const char* loc_name = std::setlocale(LC_ALL, nullptr);
-		std::string loc_name_str(loc_name != nullptr ? loc_name : "");
-		std::string loc_name_str_up(loc_name_str);
-		for (auto& c : loc_name_str_up)
-			c = (char)toupper(c);
-
-		if (loc_name_str_up.empty() || loc_name_str_up == "C" || loc_name_str_up == "POSIX" || 
-			ks_string_view(loc_name_str_up).ends_with(".UTF-8") || ks_string_view(loc_name_str_up).ends_with(".UTF8")) {
-			return wstring_from_u8_chars((const char8_t*)p, len);
-		}
-
-		using codecvt_by_loc_t = struct codecvt_byname_facet : std::codecvt_byname<wchar_t, char, std::mbstate_t> { using std::codecvt_byname<wchar_t, char, std::mbstate_t>::codecvt_byname; };
 		if (sizeof(wchar_t) == 2) {
-			using std_converter_t = std::wstring_convert<codecvt_by_loc_t, wchar_t, ks_basic_string_allocator<wchar_t>>;
-			std_converter_t std_converter(new codecvt_by_loc_t(loc_name_str.c_str()));
-			auto std_wstr = std_converter.from_bytes(str_view.data(), str_view.data() + str_view.length());
+			if (!native_conv.std_converter_ks)
+				native_conv.std_converter_ks.reset(new __std_converter_ks_t(new __codecvt_by_loc_t(native_conv.loc_name.c_str())));
+			auto std_wstr = native_conv.std_converter_ks->from_bytes(str_view.data(), str_view.data() + str_view.length());
 			return ks_immutable_wstring(std::move((std::basic_string<WCHAR, std::char_traits<WCHAR>, ks_basic_string_allocator<WCHAR>>&)(std_wstr)));
 		}
 		else {
-			using std_converter_t = std::wstring_convert<codecvt_by_loc_t, wchar_t>;
-			std_converter_t std_converter(new codecvt_by_loc_t(loc_name_str.c_str()));
-			auto std_wstr = std_converter.from_bytes(str_view.data(), str_view.data() + str_view.length());
+			if (!native_conv.std_converter)
+				native_conv.std_converter.reset(new __std_converter_t(new __codecvt_by_loc_t(native_conv.loc_name.c_str())));
+			auto std_wstr = native_conv.std_converter->from_bytes(str_view.data(), str_view.data() + str_view.length());
 			return wstring_from_native_wide_chars(std_wstr.data(), std_wstr.length());
 		}
 #endif
@@ -238,64 +1522,56 @@ namespace ks_string_util {
 		const WCHAR* const str_data = str_view.data();
 		const size_t str_length = str_view.length();
 
-		size_t char8_count = str_length;
-		for (size_t pos = 0; pos < str_length; ) {
-			WCHAR ch = str_data[pos++];
-			if ((ch & 0xFC00) == 0xD800) {
-				ASSERT(pos < str_length && (str_data[pos] & 0xFC00) == 0xDC00);
-				size_t len_addi = (std::min)(size_t(1), str_length - pos);
-				char8_count -= len_addi;
-				char8_count += 3; //11110xxxx 10xxxxxx 10xxxxxx 10xxxxxx
-				pos += len_addi;
-			}
-			else {
-				ASSERT((ch & 0xFC00) != 0xDC00);
-				if (ch <= 0x7F)
-					(void)0; //0xxxxxxx
-				else if (ch <= 0x7FF)
-					char8_count += 1; //110xxxxx 10xxxxxx
-				else
-					char8_count += 2; //1110xxxx 10xxxxxx 10xxxxxx
-			}
-		}
+		size_t char8_count = __count_u8_of_u16(str_data, str_length);
 
 		std::basic_string<char8_t> str8;
 		str8.resize(char8_count);
-		uint8_t* str8_data_p = (uint8_t*)str8.data();
-		for (size_t pos = 0; pos < str_length; ) {
-			WCHAR ch = str_data[pos++];
-			if ((ch & 0xFC00) == 0xD800) {
-				WCHAR ch_addi = pos < str_length ? str_data[pos++] : 0;
-				uint rune = 0x10000 + (((uint(ch) & 0x3FF) << 10) | (uint(ch_addi) & 0x3FF));
-				//11110xxx 10xxxxxx 10xxxxxx 10xxxxxx
-				*(str8_data_p++) = (uint8_t)(0xF0 | ((rune & 0x1C0000) >> 18));
-				*(str8_data_p++) = (uint8_t)(0x80 | ((rune & 0x03F000) >> 12));
-				*(str8_data_p++) = (uint8_t)(0x80 | ((rune & 0x000FC0) >> 6));
-				*(str8_data_p++) = (uint8_t)(0x80 | ((rune & 0x00003F)));
-			}
-			else {
-				if (ch <= 0x7F) {
-					//0xxxxxxx
-					*(str8_data_p++) = (uint8_t)(ch);
-				}
-				else if (ch <= 0x7FF) {
-					//110xxxxx 10xxxxxx
-					*(str8_data_p++) = (uint8_t)(0xC0 | ((ch & 0x7C0) >> 6));
-					*(str8_data_p++) = (uint8_t)(0x80 | ((ch & 0x003F)));
-				}
-				else {
-					//1110xxxx 10xxxxxx 10xxxxxx
-					*(str8_data_p++) = (uint8_t)(0xE0 | ((ch & 0xF000) >> 12));
-					*(str8_data_p++) = (uint8_t)(0x80 | ((ch & 0x0FC0) >> 6));
-					*(str8_data_p++) = (uint8_t)(0x80 | ((ch & 0x003F)));
-				}
-			}
-		}
+		uint8_t* str8_data_p = __encode_u16(str_data, str_data + str_length, (uint8_t*)str8.data(), (uint8_t*)str8.data() + char8_count);
 
 		ASSERT(str8_data_p == (uint8_t*)str8.data() + str8.length());
+		str8.resize(str8_data_p - (uint8_t*)str8.data());
 		return str8;
 	}
 
+	MODERN_STRING_API
+	ks_immutable_string wstring_to_u8_string(const ks_wstring_view& str_view) {
+		if (str_view.empty())
+			return ks_immutable_string();
+
+		const WCHAR* const str_data = str_view.data();
+		const size_t str_length = str_view.length();
+
+		size_t char8_count = __count_u8_of_u16(str_data, str_length);
+
+		ks_mutable_string str8;
+		char* str8_data = str8.__begin_exclusive_writing(char8_count);
+		uint8_t* str8_data_p = __encode_u16(str_data, str_data + str_length, (uint8_t*)str8_data, (uint8_t*)str8_data + char8_count);
+
+		ASSERT(str8_data_p == (uint8_t*)str8_data + char8_count);
+		str8.__end_exclusive_writing(str8_data, (char*)str8_data_p - str8_data);
+		return std::move(str8);
+	}
+
+	MODERN_STRING_API
+	ks_immutable_string wstring_to_u8_string(const ks_wstring_view& str_view, utf_error_policy policy, size_t* error_pos) {
+		ks_mutable_string str8;
+		size_t err_pos = __append_u16_encoded(str8, str_view.data(), str_view.length(), policy);
+		if (error_pos != nullptr)
+			*error_pos = err_pos;
+		return std::move(str8);
+	}
+
+	MODERN_STRING_API
+	size_t wstring_to_u8_chars(const ks_wstring_view& str_view, char8_t* dst, size_t dst_capacity) {
+		if (str_view.empty())
+			return 0;
+
+		uint8_t* dst_p = __encode_u16(str_view.data(), str_view.data() + str_view.length(), (uint8_t*)dst, (uint8_t*)dst + dst_capacity);
+		if (dst_p == nullptr)
+			throw std::out_of_range("ks_string_util::wstring_to_u8_chars(str_view, dst, dst_capacity) out-of-range exception");
+		return dst_p - (uint8_t*)dst;
+	}
+
 	MODERN_STRING_API
 	std::basic_string<char16_t> wstring_to_std_u16_string(const ks_wstring_view& str_view) {
 		return std::basic_string<char16_t>((char16_t*)str_view.data(), str_view.length());
@@ -309,54 +1585,57 @@ namespace ks_string_util {
 		const WCHAR* const str_data = str_view.data();
 		const size_t str_length = str_view.length();
 
-		size_t char32_count = str_length;
-		for (size_t pos = 0; pos < str_length; ) {
-			WCHAR ch = str_data[pos++];
-			if ((ch & 0xFC00) == 0xD800) {
-				ASSERT(pos < str_length && (str_data[pos] & 0xFC00) == 0xDC00);
-				size_t len_addi = (std::min)(size_t(1), str_length - pos);
-				char32_count -= len_addi;
-				pos += len_addi;
-			}
-			else {
-				ASSERT((ch & 0xFC00) != 0xDC00);
-			}
-		}
-
 		std::basic_string<char32_t> str32;
-		str32.resize(char32_count);
-		uint32_t* str32_data_p = (uint32_t*)str32.data();
-		for (size_t pos = 0; pos < str_length; ) {
-			WCHAR ch = str_data[pos++];
-			if ((ch & 0xFC00) == 0xD800) {
-				WCHAR ch_addi = pos < str_length ? str_data[pos++] : 0;
-				uint rune = 0x10000 + (((uint(ch) & 0x3FF) << 10) | (uint(ch_addi) & 0x3FF));
-				*(str32_data_p++) = (uint32_t)rune;
-			}
-			else {
-				*(str32_data_p++) = (uint32_t)ch;
-			}
-		}
+		str32.resize(__count_runes_of_u16(str_data, str_length));
+		uint32_t* str32_data_p = __decode_u16_runes(str_data, str_data + str_length, (uint32_t*)str32.data());
 
 		ASSERT(str32_data_p == (uint32_t*)str32.data() + str32.length());
+		str32.resize(str32_data_p - (uint32_t*)str32.data());
 		return str32;
 	}
 
+	MODERN_STRING_API
+	ks_basic_immutable_string<char32_t> wstring_to_u32_string(const ks_wstring_view& str_view) {
+		if (str_view.empty())
+			return ks_basic_immutable_string<char32_t>();
+
+		const WCHAR* const str_data = str_view.data();
+		const size_t str_length = str_view.length();
+
+		//note: the length is the bound (the pairs make it shorter), so the input is passed only once
+		ks_basic_mutable_string<char32_t> str32;
+		char32_t* str32_data = str32.__begin_exclusive_writing(str_length);
+		uint32_t* str32_data_p = __decode_u16_runes(str_data, str_data + str_length, (uint32_t*)str32_data);
+		str32.__end_exclusive_writing(str32_data, (char32_t*)str32_data_p - str32_data);
+		return std::move(str32);
+	}
+
+	MODERN_STRING_API
+	size_t wstring_to_u32_chars(const ks_wstring_view& str_view, char32_t* dst, size_t dst_capacity) {
+		if (str_view.empty())
+			return 0;
+
+		const WCHAR* const str_data = str_view.data();
+		const size_t str_length = str_view.length();
+		if (dst_capacity < str_length && __count_runes_of_u16(str_data, str_length) > dst_capacity)
+			throw std::out_of_range("ks_string_util::wstring_to_u32_chars(str_view, dst, dst_capacity) out-of-range exception");
+
+		return __decode_u16_runes(str_data, str_data + str_length, (uint32_t*)dst) - (uint32_t*)dst;
+	}
+
 	MODERN_STRING_API
 	std::string wstring_to_std_native_string(const ks_wstring_view& str_view) {
 		if (str_view.empty())
 			return std::string();
 
-#ifdef _WIN32
-		UINT acp = ::GetACP();
-		if (acp == 65001) {
+		__native_conversion& native_conv = __get_native_conversion();
+		if (native_conv.is_utf8) {
 			std::basic_string<char8_t> str8 = wstring_to_std_u8_string(str_view);
 			return std::move((std::string&)(str8));
 		}
 
-		if (acp == 936 || acp == 20936)
-			acp = 54936; //auto promote GBK or GB2312 to GB18030
-
+#ifdef _WIN32
+		const UINT acp = native_conv.acp;
 		int ach_count = ::WideCharToMultiByte(acp, 0, str_view.data(), (int)str_view.length(), NULL, 0, NULL, NULL);
 		ASSERT(ach_count > 0);
 		if (ach_count <= 0)
@@ -370,27 +1649,14 @@ namespace ks_string_util {
 		return std_str;
 
 #else
-		const char* loc_name = std::setlocale(LC_ALL, nullptr);
-		std::string loc_name_str(loc_name != nullptr ? loc_name : "");
-		std::string loc_name_str_up(loc_name_str);
-		for (auto& c : loc_name_str_up)
-			c = (char)toupper(c);
-
-		if (loc_name_str_up.empty() || loc_name_str_up == "C" || loc_name_str_up == "POSIX" || 
-			ks_string_view(loc_name_str_up).ends_with(".UTF-8") || ks_string_view(loc_name_str_up).ends_with(".UTF8")) {
-			std::basic_string<char8_t> str8 = wstring_to_std_u8_string(str_view);
-			return std::move((std::string&)(str8));
-		}
-
-		using codecvt_by_loc_t = struct codecvt_byname_facet : std::codecvt_byname<wchar_t, char, std::mbstate_t> { using std::codecvt_byname<wchar_t, char, std::mbstate_t>::codecvt_byname; };
-		using std_converter_t = std::wstring_convert<codecvt_by_loc_t, wchar_t>;
-		std_converter_t std_converter(new codecvt_by_loc_t(loc_name_str.c_str()));
+		if (!native_conv.std_converter)
+			native_conv.std_converter.reset(new __std_converter_t(new __codecvt_by_loc_t(native_conv.loc_name.c_str())));
 		if (sizeof(wchar_t) == 2) {
-			return std_converter.to_bytes((wchar_t*)str_view.data(), (wchar_t*)str_view.data() + str_view.length());
+			return native_conv.std_converter->to_bytes((wchar_t*)str_view.data(), (wchar_t*)str_view.data() + str_view.length());
 		}
 		else {
 			std::wstring std_wstr = wstring_to_std_native_wide_string(str_view);
-			return std_converter.to_bytes(std_wstr.data(), std_wstr.data() + std_wstr.length());
+			return native_conv.std_converter->to_bytes(std_wstr.data(), std_wstr.data() + std_wstr.length());
 		}
 #endif
 	}
@@ -403,8 +1669,291 @@ namespace ks_string_util {
 			return std::move((std::wstring&)(str16));
 		}
 		else {
-			std::basic_string<char32_t> str32 = wstring_to_std_u32_string(str_view);
-			return std::move((std::wstring&)(str32));
+			//decode into the std::wstring directly, rather than casting a std::u32string
+			const WCHAR* const str_data = str_view.data();
+			const size_t str_length = str_view.length();
+
+			std::wstring std_wstr;
+			std_wstr.resize(__count_runes_of_u16(str_data, str_length));
+			uint32_t* std_wstr_data_p = __decode_u16_runes(str_data, str_data + str_length, (uint32_t*)std_wstr.data());
+			ASSERT(std_wstr_data_p == (uint32_t*)std_wstr.data() + std_wstr.length());
+			std_wstr.resize(std_wstr_data_p - (uint32_t*)std_wstr.data());
+			return std_wstr;
+		}
+	}
+
+	MODERN_STRING_API
+	void refresh_native_conversion() {
+		g_native_conversion_generation.fetch_add(1, std::memory_order_acq_rel);
+	}
+
+	//length only ...
+	MODERN_STRING_API
+	size_t utf16_length_of_utf8(const char8_t* p, size_t len) {
+		ks_basic_string_view<uint8_t> str_view8((const uint8_t*)p, len);
+		return __count_u16_of_u8(str_view8.data(), str_view8.length());
+	}
+
+	MODERN_STRING_API
+	size_t utf8_length_of_utf16(const ks_wstring_view& str_view) {
+		return __count_u8_of_u16(str_view.data(), str_view.length());
+	}
+
+	//probe ...
+	MODERN_STRING_API
+	bool is_ascii(const ks_string_view& str_view) {
+		return __is_all_ascii8((const uint8_t*)str_view.data(), str_view.length());
+	}
+
+	MODERN_STRING_API
+	bool is_ascii(const ks_wstring_view& str_view) {
+		return __is_all_units_under_mask(str_view.data(), str_view.length(), (WCHAR)0xFF80);
+	}
+
+	MODERN_STRING_API
+	bool is_latin1(const ks_wstring_view& str_view) {
+		return __is_all_units_under_mask(str_view.data(), str_view.length(), (WCHAR)0xFF00);
+	}
+
+	//validate ...
+	MODERN_STRING_API
+	bool validate_utf8(const char8_t* p, size_t len, size_t* error_pos) {
+		ks_basic_string_view<uint8_t> str_view8((const uint8_t*)p, len);
+		size_t err_pos8 = __find_u8_error(str_view8.data(), str_view8.length());
+		if (error_pos != nullptr)
+			*error_pos = err_pos8;
+		return err_pos8 == size_t(-1);
+	}
+
+	MODERN_STRING_API
+	bool validate_utf16(const ks_wstring_view& str_view, size_t* error_pos) {
+		size_t err_pos = __find_u16_error(str_view.data(), str_view.length());
+		if (error_pos != nullptr)
+			*error_pos = err_pos;
+		return err_pos == size_t(-1);
+	}
+
+	MODERN_STRING_API
+	ks_immutable_string sanitize_utf8(const ks_immutable_string& str, utf_error_policy policy, size_t* error_pos) {
+		const uint8_t* p8 = (const uint8_t*)str.data();
+		const size_t len8 = str.length();
+		const size_t first_err_pos8 = __find_u8_error(p8, len8);
+		if (error_pos != nullptr)
+			*error_pos = first_err_pos8;
+		if (first_err_pos8 == size_t(-1))
+			return str;
+		if (policy == utf_error_policy::stop)
+			return str.substr(0, first_err_pos8);
+
+		ks_mutable_string str8;
+		str8.reserve(len8 + 2);
+		size_t pos8 = 0;
+		size_t err_pos8 = first_err_pos8;
+		while (true) {
+			const size_t valid_end8 = err_pos8 != size_t(-1) ? err_pos8 : len8;
+			str8.append(ks_string_view((const char*)p8 + pos8, valid_end8 - pos8));
+			if (err_pos8 == size_t(-1))
+				break;
+
+			size_t bad_len8 = 0;
+			__u8_check_seq(p8 + err_pos8, p8 + len8, &bad_len8);
+			if (policy == utf_error_policy::replace)
+				str8.append(ks_string_view("\xEF\xBF\xBD", 3));
+
+			pos8 = err_pos8 + bad_len8;
+			err_pos8 = __find_u8_error(p8 + pos8, len8 - pos8);
+			if (err_pos8 != size_t(-1))
+				err_pos8 += pos8;
+		}
+		return ks_immutable_string(std::move(str8));
+	}
+
+	//utf8 runes ...
+	MODERN_STRING_API
+	size_t u8_rune_count(const ks_string_view& str_view) {
+		const uint8_t* p8 = (const uint8_t*)str_view.data();
+		const size_t len8 = str_view.length();
+		size_t rune_count = 0;
+		size_t pos8 = 0;
+		size_t err_pos8 = __find_u8_error(p8, len8);
+		while (true) {
+			const size_t valid_end8 = err_pos8 != size_t(-1) ? err_pos8 : len8;
+			rune_count += __count_u8_runes_of_valid(p8 + pos8, valid_end8 - pos8);
+			if (err_pos8 == size_t(-1))
+				break;
+
+			size_t bad_len8 = 0;
+			__u8_check_seq(p8 + err_pos8, p8 + len8, &bad_len8);
+			++rune_count; //as U+FFFD
+
+			pos8 = err_pos8 + bad_len8;
+			err_pos8 = __find_u8_error(p8 + pos8, len8 - pos8);
+			if (err_pos8 != size_t(-1))
+				err_pos8 += pos8;
+		}
+		return rune_count;
+	}
+
+	//utf16 runes ...
+	MODERN_STRING_API
+	size_t decode_runes(const ks_wstring_view& str_view, char32_t* dst) {
+		uint32_t* dst32 = (uint32_t*)dst;
+		return __decode_u16_runes(str_view.data(), str_view.data() + str_view.length(), dst32) - dst32;
+	}
+
+	//streaming ...
+	void u8_stream_decoder::decode(const char8_t* p, size_t len, ks_mutable_wstring& output) {
+		if (m_stopped)
+			return;
+
+		ks_basic_string_view<uint8_t> str_view8((const uint8_t*)p, len);
+		const uint8_t* const str_data8 = str_view8.data();
+		const size_t str_length8 = str_view8.length();
+		size_t pos8 = 0;
+
+		//complete the carried sequence first
+		if (m_carry_len != 0) {
+			uint8_t seq8[4];
+			std::copy_n(m_carry, m_carry_len, seq8);
+			const size_t take8 = (std::min)(sizeof(seq8) - m_carry_len, str_length8);
+			std::copy_n(str_data8, take8, seq8 + m_carry_len);
+			const size_t seq_len8 = m_carry_len + take8;
+
+			size_t bad_len8 = 0;
+			size_t good_len8 = __u8_check_seq(seq8, seq8 + seq_len8, &bad_len8);
+			if (good_len8 == 0 && bad_len8 == seq_len8) {
+				//still partial
+				std::copy_n(seq8, seq_len8, m_carry);
+				m_carry_len = seq_len8;
+				m_stream_pos += str_length8;
+				return;
+			}
+
+			const size_t used_len8 = good_len8 != 0 ? good_len8 : bad_len8;
+			const size_t carry_pos8 = m_stream_pos - m_carry_len;
+			ASSERT(used_len8 >= m_carry_len);
+			pos8 = used_len8 - m_carry_len;
+			m_carry_len = 0;
+			if (__append_u8_decoded(output, seq8, used_len8, m_policy) != size_t(-1)) {
+				this->on_error(carry_pos8);
+				if (m_stopped)
+					return;
+			}
+		}
+
+		//keep the partial sequence at the end for the next call
+		size_t end8 = str_length8;
+		for (size_t j = 1; j <= 3 && j <= str_length8 - pos8; ++j) {
+			uint8_t ch8 = str_data8[str_length8 - j];
+			if ((ch8 & 0xC0) != 0x80) {
+				size_t bad_len8 = 0;
+				if (ch8 >= 0xC2 && __u8_check_seq(str_data8 + str_length8 - j, str_data8 + str_length8, &bad_len8) == 0 && bad_len8 == j)
+					end8 = str_length8 - j;
+				break;
+			}
+		}
+
+		size_t err_pos8 = __append_u8_decoded(output, str_data8 + pos8, end8 - pos8, m_policy);
+		if (err_pos8 != size_t(-1)) {
+			this->on_error(m_stream_pos + pos8 + err_pos8);
+			if (m_stopped)
+				return;
+		}
+
+		m_carry_len = str_length8 - end8;
+		std::copy_n(str_data8 + end8, m_carry_len, m_carry);
+		m_stream_pos += str_length8;
+	}
+
+	void u8_stream_decoder::finish(ks_mutable_wstring& output) {
+		if (!m_stopped && m_carry_len != 0) {
+			//the carried sequence is a truncated one (a maximal subpart) now
+			__append_u8_decoded(output, m_carry, m_carry_len, m_policy);
+			this->on_error(m_stream_pos - m_carry_len);
+		}
+		m_carry_len = 0;
+	}
+
+	void u8_stream_decoder::reset() {
+		m_carry_len = 0;
+		m_stream_pos = 0;
+		m_error_pos = size_t(-1);
+		m_stopped = false;
+	}
+
+	void u8_stream_decoder::on_error(size_t err_pos) {
+		if (m_error_pos == size_t(-1))
+			m_error_pos = err_pos;
+		if (m_policy == utf_error_policy::stop) {
+			m_stopped = true;
+			m_carry_len = 0;
+		}
+	}
+
+	void u8_stream_encoder::encode(const ks_wstring_view& str_view, ks_mutable_string& output) {
+		if (m_stopped)
+			return;
+
+		const WCHAR* const str_data = str_view.data();
+		const size_t str_length = str_view.length();
+		if (str_length == 0)
+			return;
+
+		size_t pos = 0;
+
+		//complete the carried high surrogate first
+		if (m_carry_valid) {
+			WCHAR pair[2] = { m_carry, str_data[0] };
+			const size_t used_len = (str_data[0] & 0xFC00) == 0xDC00 ? 2 : 1;
+			pos = used_len - 1;
+			m_carry_valid = false;
+			if (__append_u16_encoded(output, pair, used_len, m_policy) != size_t(-1)) {
+				this->on_error(m_stream_pos - 1);
+				if (m_stopped)
+					return;
+			}
+		}
+
+		//keep the high surrogate at the end for the next call
+		size_t end = str_length;
+		if (pos < end && (str_data[end - 1] & 0xFC00) == 0xD800)
+			--end;
+
+		size_t err_pos = __append_u16_encoded(output, str_data + pos, end - pos, m_policy);
+		if (err_pos != size_t(-1)) {
+			this->on_error(m_stream_pos + pos + err_pos);
+			if (m_stopped)
+				return;
+		}
+
+		if (end != str_length) {
+			m_carry = str_data[end];
+			m_carry_valid = true;
+		}
+		m_stream_pos += str_length;
+	}
+
+	void u8_stream_encoder::finish(ks_mutable_string& output) {
+		if (!m_stopped && m_carry_valid) {
+			__append_u16_encoded(output, &m_carry, 1, m_policy);
+			this->on_error(m_stream_pos - 1);
+		}
+		m_carry_valid = false;
+	}
+
+	void u8_stream_encoder::reset() {
+		m_carry_valid = false;
+		m_stream_pos = 0;
+		m_error_pos = size_t(-1);
+		m_stopped = false;
+	}
+
+	void u8_stream_encoder::on_error(size_t err_pos) {
+		if (m_error_pos == size_t(-1))
+			m_error_pos = err_pos;
+		if (m_policy == utf_error_policy::stop) {
+			m_stopped = true;
+			m_carry_valid = false;
 		}
 	}
 
@@ -418,16 +1967,63 @@ namespace ks_string_util {
 
 		ASSERT(*pos < str_view.length());
 		WCHAR ch = *pos < str_view.length() ? str_view[(*pos)++] : 0;
-		if ((ch & 0xFC00) == 0xD800) {
-			ASSERT(*pos < str_view.length() && (str_view[*pos] & 0xFC00) == 0xDC00);
-			WCHAR ch_addi = *pos < str_view.length() ? str_view[(*pos)++] : 0;
+		if ((ch & 0xFC00) == 0xD800 && *pos < str_view.length() && (str_view[*pos] & 0xFC00) == 0xDC00) {
+			WCHAR ch_addi = str_view[(*pos)++];
 			uint rune = 0x10000 + (((uint(ch) & 0x3FF) << 10) | (uint(ch_addi) & 0x3FF));
 			return (char32_t)(rune);
 		}
 		else {
-			ASSERT((ch & 0xFC00) != 0xDC00);
+			//a lone surrogate is taken as a rune by itself, like the rune decoding
 			return (char32_t)(ch);
 		}
 	}
 
+	MODERN_STRING_API
+	char32_t __take_next_rune(const ks_string_view& str_view, size_t* pos) {
+		size_t temp_pos;
+		if (pos == nullptr) {
+			temp_pos = 0;
+			pos = &temp_pos;
+		}
+
+		ASSERT(*pos < str_view.length());
+		if (*pos >= str_view.length())
+			return 0;
+
+		const uint8_t* p8 = (const uint8_t*)str_view.data() + *pos;
+		size_t bad_len8 = 0;
+		size_t seq_len8 = __u8_check_seq(p8, (const uint8_t*)str_view.data() + str_view.length(), &bad_len8);
+		if (seq_len8 == 0) {
+			*pos += bad_len8;
+			return (char32_t)(0xFFFD);
+		}
+
+		*pos += seq_len8;
+		switch (seq_len8) {
+		case 1:
+			return (char32_t)(p8[0]);
+		case 2:
+			return (char32_t)(((uint(p8[0]) & 0x1F) << 6) | (uint(p8[1]) & 0x3F));
+		case 3:
+			return (char32_t)(((uint(p8[0]) & 0x0F) << 12) | ((uint(p8[1]) & 0x3F) << 6) | (uint(p8[2]) & 0x3F));
+		default:
+			return (char32_t)(((uint(p8[0]) & 0x07) << 18) | ((uint(p8[1]) & 0x3F) << 12) | ((uint(p8[2]) & 0x3F) << 6) | (uint(p8[3]) & 0x3F));
+		}
+	}
+
+	MODERN_STRING_API
+	size_t __u8_rune_count_of_valid(const char* p, size_t len) {
+		return __count_u8_runes_of_valid((const uint8_t*)p, len);
+	}
+
+	MODERN_STRING_API
+	size_t __u8_offset_of_rune(const char* p, size_t len, size_t rune_index) {
+		return __offset_of_u8_rune_of_valid((const uint8_t*)p, len, rune_index);
+	}
+
+	MODERN_STRING_API
+	bool __try_narrow_to_latin1(const WCHAR* p, size_t len, char* dst) {
+		return __narrow_latin1(p, len, (uint8_t*)dst);
+	}
+
 }
@@ -16,15 +16,32 @@ limitations under the License.
 #pragma once
 
 #include "ks_string.h"
+#include <iterator>
 
 namespace ks_string_util {
+	//how the invalid input is treated in the validating converters:
+	//replace each maximal invalid subpart with U+FFFD, stop before the first error, or skip the invalid subparts.
+	enum class utf_error_policy {
+		replace = 0,
+		stop = 1,
+		skip = 2,
+	};
+
 	//convert from ...
 	MODERN_STRING_API
 	ks_immutable_wstring wstring_from_u8_chars(const char8_t* p, size_t len);
 	MODERN_STRING_API
+	ks_immutable_wstring wstring_from_u8_chars(const char8_t* p, size_t len, utf_error_policy policy, size_t* error_pos = nullptr); //error_pos takes the offset of the first error, or size_t(-1)
+	MODERN_STRING_API
+	size_t wstring_from_u8_chars(const char8_t* p, size_t len, WCHAR* dst, size_t dst_capacity); //return the count written (not zero-terminated), throw out_of_range if dst_capacity is not enough
+	MODERN_STRING_API
 	ks_immutable_wstring wstring_from_u16_chars(const char16_t* p, size_t len); //you can use ks_immutable_wstring(p, len) directly, also
 	MODERN_STRING_API
 	ks_immutable_wstring wstring_from_u32_chars(const char32_t* p, size_t len);
+	MODERN_STRING_API
+	ks_immutable_wstring wstring_from_latin1_chars(const char* p, size_t len);
+	MODERN_STRING_API
+	size_t wstring_from_latin1_chars(const char* p, size_t len, WCHAR* dst, size_t dst_capacity); //return the count written (not zero-terminated), throw out_of_range if dst_capacity is not enough
 
 	MODERN_STRING_API
 	ks_immutable_wstring wstring_from_native_chars(const char* p, size_t len);
@@ -35,15 +52,185 @@ namespace ks_string_util {
 	MODERN_STRING_API
 	std::basic_string<char8_t> wstring_to_std_u8_string(const ks_wstring_view& str_view);
 	MODERN_STRING_API
+	ks_immutable_string wstring_to_u8_string(const ks_wstring_view& str_view); //prefer it to wstring_to_std_u8_string, no zero-filling
+	MODERN_STRING_API
+	ks_immutable_string wstring_to_u8_string(const ks_wstring_view& str_view, utf_error_policy policy, size_t* error_pos = nullptr); //error_pos takes the offset of the first lone surrogate, or size_t(-1)
+	MODERN_STRING_API
+	size_t wstring_to_u8_chars(const ks_wstring_view& str_view, char8_t* dst, size_t dst_capacity); //return the count written (not zero-terminated), throw out_of_range if dst_capacity is not enough
+	MODERN_STRING_API
 	std::basic_string<char16_t> wstring_to_std_u16_string(const ks_wstring_view& str_view); //you can use str.data() and str.length() directly, also
 	MODERN_STRING_API
 	std::basic_string<char32_t> wstring_to_std_u32_string(const ks_wstring_view& str_view);
+	MODERN_STRING_API
+	ks_basic_immutable_string<char32_t> wstring_to_u32_string(const ks_wstring_view& str_view); //prefer it to wstring_to_std_u32_string, no zero-filling
+	MODERN_STRING_API
+	size_t wstring_to_u32_chars(const ks_wstring_view& str_view, char32_t* dst, size_t dst_capacity); //return the count written (not zero-terminated), throw out_of_range if dst_capacity is not enough
 
 	MODERN_STRING_API
 	std::string wstring_to_std_native_string(const ks_wstring_view& str_view);
 	MODERN_STRING_API
 	std::wstring wstring_to_std_native_wide_string(const ks_wstring_view& str_view);
 
+	//the native conversion is resolved from the locale once and cached, call it after setlocale() to take the new locale
+	MODERN_STRING_API
+	void refresh_native_conversion();
+
+	//length only ...
+	//note: they agree with the converters exactly, so they can be used to size the buffers for the dst versions.
+	MODERN_STRING_API
+	size_t utf16_length_of_utf8(const char8_t* p, size_t len);
+	MODERN_STRING_API
+	size_t utf8_length_of_utf16(const ks_wstring_view& str_view);
+
+	//probe ...
+	MODERN_STRING_API
+	bool is_ascii(const ks_string_view& str_view);
+	MODERN_STRING_API
+	bool is_ascii(const ks_wstring_view& str_view);
+	MODERN_STRING_API
+	bool is_latin1(const ks_wstring_view& str_view); //no unit is above 0xFF
+
+	//validate ...
+	MODERN_STRING_API
+	bool validate_utf8(const char8_t* p, size_t len, size_t* error_pos = nullptr);
+	MODERN_STRING_API
+	bool validate_utf16(const ks_wstring_view& str_view, size_t* error_pos = nullptr);
+	MODERN_STRING_API
+	ks_immutable_string sanitize_utf8(const ks_immutable_string& str, utf_error_policy policy = utf_error_policy::replace, size_t* error_pos = nullptr); //return str itself (shared) if it is valid already
+
+	//utf8 runes ...
+	//note: each maximal invalid subpart is counted as one rune (as U+FFFD), the same as __take_next_rune does.
+	MODERN_STRING_API
+	size_t u8_rune_count(const ks_string_view& str_view);
+
+	//utf16 runes ...
+	//note: a surrogate pair makes one rune, and a lone surrogate is taken as a rune by itself.
+	class u16_rune_iterator {
+	public:
+		using iterator_category = std::bidirectional_iterator_tag;
+		using value_type = char32_t;
+		using difference_type = ptrdiff_t;
+		using pointer = const char32_t*;
+		using reference = char32_t;
+
+		u16_rune_iterator() : m_p(nullptr), m_begin(nullptr), m_end(nullptr) {}
+		u16_rune_iterator(const WCHAR* p, const WCHAR* begin, const WCHAR* end) : m_p(p), m_begin(begin), m_end(end) {}
+
+		char32_t operator*() const {
+			uint ch = m_p[0];
+			if (this->is_pair_at(m_p))
+				return (char32_t)(0x10000 + (((ch & 0x3FF) << 10) | (uint(m_p[1]) & 0x3FF)));
+			return (char32_t)(ch);
+		}
+
+		u16_rune_iterator& operator++() {
+			m_p += this->is_pair_at(m_p) ? 2 : 1;
+			return *this;
+		}
+		u16_rune_iterator& operator--() {
+			--m_p;
+			if (m_p > m_begin && this->is_pair_at(m_p - 1))
+				--m_p;
+			return *this;
+		}
+		u16_rune_iterator operator++(int) { u16_rune_iterator ret = *this; ++(*this); return ret; }
+		u16_rune_iterator operator--(int) { u16_rune_iterator ret = *this; --(*this); return ret; }
+
+		bool operator==(const u16_rune_iterator& right) const { return m_p == right.m_p; }
+		bool operator!=(const u16_rune_iterator& right) const { return m_p != right.m_p; }
+
+		const WCHAR* base() const { return m_p; } //the unit position of the rune
+
+	private:
+		bool is_pair_at(const WCHAR* p) const {
+			return (uint(p[0]) & 0xFC00) == 0xD800 && p + 1 < m_end && (uint(p[1]) & 0xFC00) == 0xDC00;
+		}
+
+		const WCHAR* m_p;
+		const WCHAR* m_begin;
+		const WCHAR* m_end;
+	};
+
+	//the rune range for range-based for, it refers to the data of str_view
+	struct u16_rune_range {
+		const WCHAR* first;
+		const WCHAR* last;
+
+		u16_rune_iterator begin() const { return u16_rune_iterator(first, first, last); }
+		u16_rune_iterator end() const { return u16_rune_iterator(last, first, last); }
+		std::reverse_iterator<u16_rune_iterator> rbegin() const { return std::reverse_iterator<u16_rune_iterator>(this->end()); }
+		std::reverse_iterator<u16_rune_iterator> rend() const { return std::reverse_iterator<u16_rune_iterator>(this->begin()); }
+	};
+
+	inline u16_rune_range u16_runes(const ks_wstring_view& str_view) {
+		return u16_rune_range{ str_view.data(), str_view.data() + str_view.length() };
+	}
+
+	MODERN_STRING_API
+	size_t decode_runes(const ks_wstring_view& str_view, char32_t* dst); //dst must take str_view.length() runes, return the count written
+
+	//streaming ...
+	//the decoder/encoder accepts the input chunk by chunk, and carries the sequence split by the chunk boundary to the next call.
+	//note: the error_pos() is the offset in the whole stream, and a partial sequence left at finish() is treated as an error.
+	class MODERN_STRING_API u8_stream_decoder {
+	public:
+		explicit u8_stream_decoder(utf_error_policy policy = utf_error_policy::replace) : m_policy(policy) {}
+
+		void decode(const char8_t* p, size_t len, ks_mutable_wstring& output);
+		void finish(ks_mutable_wstring& output);
+		void reset();
+
+		bool has_error() const { return m_error_pos != size_t(-1); }
+		size_t error_pos() const { return m_error_pos; }
+
+	private:
+		void on_error(size_t err_pos);
+
+		utf_error_policy m_policy;
+		uint8_t m_carry[4] = { 0 };
+		size_t m_carry_len = 0;
+		size_t m_stream_pos = 0;
+		size_t m_error_pos = size_t(-1);
+		bool m_stopped = false;
+	};
+
+	class MODERN_STRING_API u8_stream_encoder {
+	public:
+		explicit u8_stream_encoder(utf_error_policy policy = utf_error_policy::replace) : m_policy(policy) {}
+
+		void encode(const ks_wstring_view& str_view, ks_mutable_string& output);
+		void finish(ks_mutable_string& output);
+		void reset();
+
+		bool has_error() const { return m_error_pos != size_t(-1); }
+		size_t error_pos() const { return m_error_pos; }
+
+	private:
+		void on_error(size_t err_pos);
+
+		utf_error_policy m_policy;
+		WCHAR m_carry = 0;
+		bool m_carry_valid = false;
+		size_t m_stream_pos = 0;
+		size_t m_error_pos = size_t(-1);
+		bool m_stopped = false;
+	};
+
 	MODERN_STRING_API
 	char32_t __take_next_rune(const ks_wstring_view& str_view, size_t* pos);
+	MODERN_STRING_API
+	char32_t __take_next_rune(const ks_string_view& str_view, size_t* pos); //utf8 version
+
+	//the rune kernels for the well-formed utf8 (no check)
+	MODERN_STRING_API
+	size_t __u8_rune_count_of_valid(const char* p, size_t len);
+	MODERN_STRING_API
+	size_t __u8_offset_of_rune(const char* p, size_t len, size_t rune_index); //return len if rune_index is out of range
+
+	//the probe and narrowing in one pass, return false if any unit is above 0xFF (then dst is written partly)
+	MODERN_STRING_API
+	bool __try_narrow_to_latin1(const WCHAR* p, size_t len, char* dst);
 }
+
+#include "ks_immutable_u8string.h" //it depends on the utf8 utilities above
+#include "ks_compact_wstring.h"
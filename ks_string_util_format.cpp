@@ -0,0 +1,356 @@
+﻿/* Copyright 2024 The Kingsoft's modern-string Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "ks_number_chars.h"
+#include "ks_string_util_simd.h"
+#include "ks_string_util_pow10_table.h"
+#include <cstring>
+
+namespace ks_string_util {
+	static const char s_digit_pairs[201] =
+		"0001020304050607080910111213141516171819202122232425262728293031323334353637383940414243444546474849"
+		"5051525354555657585960616263646566676869707172737475767778798081828384858687888990919293949596979899";
+
+	static inline int __count_digits(uint64_t v) {
+		static const uint64_t s_pow10_table[20] = {
+			0, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000,
+			10000000000, 100000000000, 1000000000000, 10000000000000, 100000000000000, 1000000000000000,
+			10000000000000000, 100000000000000000, 1000000000000000000, 10000000000000000000u };
+		//t = floor(log10(2^bits)) approximately, then it is fixed by one comparison
+		const int t = ((64 - (int)__simd::clz64(v | 1)) * 1233) >> 12;
+		return t + (v >= s_pow10_table[t] ? 1 : 0);
+	}
+
+	template <class ELEM>
+	static inline void __write_digit_pair(ELEM* p, uint32_t r) {
+		p[0] = ELEM(s_digit_pairs[r * 2]);
+		p[1] = ELEM(s_digit_pairs[r * 2 + 1]);
+	}
+
+	//write the digits of v backward, ending at end (two digits at once by the pair table, and 8 digits a round for the high part)
+	template <class ELEM>
+	static inline void __write_digits_backward(ELEM* end, uint64_t v) {
+		while (v >= 100000000) {
+			const uint32_t chunk = uint32_t(v % 100000000);
+			v /= 100000000;
+			const uint32_t chunk_hi = chunk / 10000, chunk_lo = chunk % 10000;
+			__write_digit_pair(end - 2, chunk_lo % 100);
+			__write_digit_pair(end - 4, chunk_lo / 100);
+			__write_digit_pair(end - 6, chunk_hi % 100);
+			__write_digit_pair(end - 8, chunk_hi / 100);
+			end -= 8;
+		}
+
+		uint32_t v32 = uint32_t(v);
+		while (v32 >= 100) {
+			end -= 2;
+			__write_digit_pair(end, v32 % 100);
+			v32 /= 100;
+		}
+		if (v32 >= 10)
+			__write_digit_pair(end - 2, v32);
+		else
+			end[-1] = ELEM('0' + v32);
+	}
+
+	template <class ELEM>
+	static size_t __do_format_uint64(uint64_t v, ELEM* dst) {
+		const int n = __count_digits(v);
+		__write_digits_backward(dst + n, v);
+		return n;
+	}
+
+	template <class ELEM>
+	static size_t __do_format_uint64_hex(uint64_t v, ELEM* dst, bool is_upper) {
+		const char* const hex_digits = is_upper ? "0123456789ABCDEF" : "0123456789abcdef";
+		const size_t n = (64 - __simd::clz64(v | 1) + 3) / 4;
+		for (size_t i = n; i != 0; --i) {
+			dst[i - 1] = ELEM(hex_digits[v & 0xF]);
+			v >>= 4;
+		}
+		return n;
+	}
+
+	template <class ELEM>
+	static size_t __do_format_int64(int64_t v, ELEM* dst) {
+		if (v < 0) {
+			dst[0] = '-';
+			return 1 + __do_format_uint64(0 - uint64_t(v), dst + 1);
+		}
+		return __do_format_uint64(uint64_t(v), dst);
+	}
+
+	namespace __float_format {
+		//the shortest decimal which is parsed back to the float: the value is digits * 10^exponent
+		struct __decimal {
+			uint64_t digits;
+			int exponent;
+		};
+
+		//floor(x / 2^n) for the negative x also
+		static inline int __floor_shift(int x, int n) {
+			return x >> n;
+		}
+
+		//the high part of g * cp (g is 128-bit) with the sticky bit of the dropped part (round to odd)
+		static inline uint64_t __round_to_odd(uint64_t g_high, uint64_t g_low, uint64_t cp) {
+			uint64_t x_high;
+			__simd::umul128(g_low, cp, &x_high);
+			uint64_t y_high;
+			uint64_t y_low = __simd::umul128(g_high, cp, &y_high);
+			y_low += x_high;
+			if (y_low < x_high)
+				++y_high;
+			return y_high | (y_low > 1 ? 1 : 0);
+		}
+
+		static inline uint32_t __round_to_odd(uint64_t g, uint32_t cp) {
+			uint64_t high;
+			const uint64_t low = __simd::umul128(g, cp, &high);
+			return uint32_t(high) | ((low >> 32) > 1 ? 1 : 0);
+		}
+
+		//the schubfach algorithm (by raffaello giulietti): among the decimals inside the rounding interval of the float,
+		//the one with the fewest digits is taken, and the closest one if there are more.
+		template <class UINT_TYPE, int MANTISSA_BITS, int EXPONENT_BIAS, class ROUND_FN>
+		static __decimal __to_decimal(UINT_TYPE ieee_mantissa, int ieee_exponent, ROUND_FN round_fn) {
+			constexpr UINT_TYPE hidden_bit = UINT_TYPE(1) << MANTISSA_BITS;
+			UINT_TYPE c;
+			int q;
+			if (ieee_exponent != 0) {
+				c = hidden_bit | ieee_mantissa;
+				q = ieee_exponent - EXPONENT_BIAS;
+				//the small integer is exact
+				if (q <= 0 && -q <= MANTISSA_BITS && (c & ((UINT_TYPE(1) << -q) - 1)) == 0)
+					return __decimal{ uint64_t(c >> -q), 0 };
+			}
+			else {
+				c = ieee_mantissa;
+				q = 1 - EXPONENT_BIAS;
+			}
+
+			const bool is_even = (c & 1) == 0;
+			const bool is_lower_closer = ieee_mantissa == 0 && ieee_exponent > 1;
+
+			const UINT_TYPE cbl = 4 * c - 2 + (is_lower_closer ? 1 : 0);
+			const UINT_TYPE cb = 4 * c;
+			const UINT_TYPE cbr = 4 * c + 2;
+
+			//k = floor(log10(2^q)), or floor(log10(3/4 * 2^q)) if the lower boundary is closer
+			const int k = __floor_shift(q * 1262611 - (is_lower_closer ? 524031 : 0), 22);
+			//h = q + floor(log2(10^-k)) + 1, it is in [1, 4]
+			const int h = q + __floor_shift(-k * 1741647, 19) + 1;
+			ASSERT(h >= 1 && h <= 4);
+
+			const UINT_TYPE vbl = round_fn(-k, UINT_TYPE(cbl << h));
+			const UINT_TYPE vb = round_fn(-k, UINT_TYPE(cb << h));
+			const UINT_TYPE vbr = round_fn(-k, UINT_TYPE(cbr << h));
+
+			const UINT_TYPE lower = vbl + (is_even ? 0 : 1);
+			const UINT_TYPE upper = vbr - (is_even ? 0 : 1);
+
+			const UINT_TYPE s = vb / 4;
+			if (s >= 10) {
+				//one digit less, at most one of the two candidates is inside
+				const UINT_TYPE sp = s / 10;
+				const bool up_inside = lower <= 40 * sp;
+				const bool wp_inside = 40 * sp + 40 <= upper;
+				if (up_inside != wp_inside)
+					return __decimal{ uint64_t(sp + (wp_inside ? 1 : 0)), k + 1 };
+			}
+
+			const bool u_inside = lower <= 4 * s;
+			const bool w_inside = 4 * s + 4 <= upper;
+			if (u_inside != w_inside)
+				return __decimal{ uint64_t(s + (w_inside ? 1 : 0)), k };
+
+			//both are inside, the closer one is taken (and the even one for the tie)
+			const UINT_TYPE mid = 4 * s + 2;
+			const bool round_up = vb > mid || (vb == mid && (s & 1) != 0);
+			return __decimal{ uint64_t(s + (round_up ? 1 : 0)), k };
+		}
+
+		static __decimal __double_to_decimal(uint64_t ieee_mantissa, int ieee_exponent) {
+			return __to_decimal<uint64_t, 52, 1075>(ieee_mantissa, ieee_exponent, [](int e, uint64_t cp) -> uint64_t {
+				const uint64_t* g = &__pow10_128_table[2 * (e - __pow10_table_min_e)];
+				return __round_to_odd(g[0], g[1], cp);
+				});
+		}
+
+		static __decimal __float_to_decimal(uint32_t ieee_mantissa, int ieee_exponent) {
+			return __to_decimal<uint32_t, 23, 150>(ieee_mantissa, ieee_exponent, [](int e, uint32_t cp) -> uint32_t {
+				//the 64-bit g is floor(10^e * 2^(63 - floor(e * log2(10)))) + 1, derived from the 128-bit one
+				const uint64_t* g = &__pow10_128_table[2 * (e - __pow10_table_min_e)];
+				return __round_to_odd(g[1] != 0 ? g[0] + 1 : g[0], cp);
+				});
+		}
+
+		template <class ELEM>
+		static size_t __write_ascii(ELEM* dst, const char* str) {
+			size_t n = 0;
+			for (; str[n] != 0; ++n)
+				dst[n] = ELEM(str[n]);
+			return n;
+		}
+
+		//write digits * 10^exponent by the rule of javascript (the fixed notation for 1e-6 <= |v| < 1e21)
+		template <class ELEM>
+		static size_t __format_decimal(ELEM* dst, bool is_negative, uint64_t digits, int exponent) {
+			ELEM* p = dst;
+			if (is_negative)
+				*p++ = '-';
+			if (digits == 0) {
+				*p++ = '0';
+				return p - dst;
+			}
+
+			while (digits % 10 == 0) {
+				digits /= 10;
+				++exponent;
+			}
+
+			const int k = __count_digits(digits);
+			const int n = k + exponent; //the value is 0.digits * 10^n
+			if (k <= n && n <= 21) {
+				//integer, with the trailing zeros
+				__write_digits_backward(p + k, digits);
+				p += k;
+				for (int i = k; i < n; ++i)
+					*p++ = '0';
+			}
+			else if (0 < n && n <= 21) {
+				//the point is inside the digits
+				__write_digits_backward(p + k + 1, digits);
+				for (int i = 0; i < n; ++i)
+					p[i] = p[i + 1];
+				p[n] = '.';
+				p += k + 1;
+			}
+			else if (-6 < n && n <= 0) {
+				*p++ = '0';
+				*p++ = '.';
+				for (int i = n; i < 0; ++i)
+					*p++ = '0';
+				__write_digits_backward(p + k, digits);
+				p += k;
+			}
+			else {
+				//d[.ddd]e+x
+				__write_digits_backward(p + k + 1, digits);
+				p[0] = p[1];
+				if (k == 1) {
+					p += 1;
+				}
+				else {
+					p[1] = '.';
+					p += k + 1;
+				}
+				const int e = n - 1;
+				*p++ = 'e';
+				*p++ = e < 0 ? '-' : '+';
+				p += __do_format_uint64(uint64_t(e < 0 ? -e : e), p);
+			}
+			return p - dst;
+		}
+	}
+
+	template <class ELEM>
+	static size_t __do_format_double(double v, ELEM* dst) {
+		using namespace __float_format;
+		uint64_t bits;
+		memcpy(&bits, &v, sizeof(bits));
+		const bool is_negative = (bits >> 63) != 0;
+		const uint64_t ieee_mantissa = bits & ((uint64_t(1) << 52) - 1);
+		const int ieee_exponent = int((bits >> 52) & 0x7FF);
+
+		if (ieee_exponent == 0x7FF)
+			return __write_ascii(dst, ieee_mantissa != 0 ? "nan" : is_negative ? "-inf" : "inf");
+		if (ieee_exponent == 0 && ieee_mantissa == 0)
+			return __format_decimal(dst, is_negative, 0, 0);
+
+		const __decimal dec = __double_to_decimal(ieee_mantissa, ieee_exponent);
+		return __format_decimal(dst, is_negative, dec.digits, dec.exponent);
+	}
+
+	template <class ELEM>
+	static size_t __do_format_float(float v, ELEM* dst) {
+		using namespace __float_format;
+		uint32_t bits;
+		memcpy(&bits, &v, sizeof(bits));
+		const bool is_negative = (bits >> 31) != 0;
+		const uint32_t ieee_mantissa = bits & ((uint32_t(1) << 23) - 1);
+		const int ieee_exponent = int((bits >> 23) & 0xFF);
+
+		if (ieee_exponent == 0xFF)
+			return __write_ascii(dst, ieee_mantissa != 0 ? "nan" : is_negative ? "-inf" : "inf");
+		if (ieee_exponent == 0 && ieee_mantissa == 0)
+			return __format_decimal(dst, is_negative, 0, 0);
+
+		const __decimal dec = __float_to_decimal(ieee_mantissa, ieee_exponent);
+		return __format_decimal(dst, is_negative, dec.digits, dec.exponent);
+	}
+
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	////////////////////////////////////////////////////////////////////////////////////////
+
+	//format int ...
+	MODERN_STRING_API
+	size_t int64_to_chars(int64_t v, char* dst) {
+		return __do_format_int64(v, dst);
+	}
+	MODERN_STRING_API
+	size_t int64_to_chars(int64_t v, WCHAR* dst) {
+		return __do_format_int64(v, dst);
+	}
+
+	MODERN_STRING_API
+	size_t uint64_to_chars(uint64_t v, char* dst) {
+		return __do_format_uint64(v, dst);
+	}
+	MODERN_STRING_API
+	size_t uint64_to_chars(uint64_t v, WCHAR* dst) {
+		return __do_format_uint64(v, dst);
+	}
+
+	MODERN_STRING_API
+	size_t uint64_to_hex_chars(uint64_t v, char* dst, bool is_upper) {
+		return __do_format_uint64_hex(v, dst, is_upper);
+	}
+	MODERN_STRING_API
+	size_t uint64_to_hex_chars(uint64_t v, WCHAR* dst, bool is_upper) {
+		return __do_format_uint64_hex(v, dst, is_upper);
+	}
+
+	//format float ...
+	MODERN_STRING_API
+	size_t float_to_chars(float v, char* dst) {
+		return __do_format_float(v, dst);
+	}
+	MODERN_STRING_API
+	size_t float_to_chars(float v, WCHAR* dst) {
+		return __do_format_float(v, dst);
+	}
+
+	MODERN_STRING_API
+	size_t double_to_chars(double v, char* dst) {
+		return __do_format_double(v, dst);
+	}
+	MODERN_STRING_API
+	size_t double_to_chars(double v, WCHAR* dst) {
+		return __do_format_double(v, dst);
+	}
+
+}
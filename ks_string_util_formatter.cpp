@@ -0,0 +1,181 @@
+﻿/* Copyright 2024 The Kingsoft's modern-string Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "ks_string_util_formatter.h"
+
+namespace ks_string_util {
+	template <class ELEM>
+	static void __format_piece_of(__format_piece<ELEM>* piece, const __format_arg<ELEM>& arg, const __format_spec& spec) {
+		using kind_t = typename __format_arg<ELEM>::kind_t;
+		static const ELEM s_true_chars[] = { 't', 'r', 'u', 'e' };
+		static const ELEM s_false_chars[] = { 'f', 'a', 'l', 's', 'e' };
+
+		const bool is_number = arg.kind != kind_t::string_kind && arg.kind != kind_t::char_kind && arg.kind != kind_t::bool_kind;
+		const bool is_integer = arg.kind == kind_t::int_kind || arg.kind == kind_t::uint_kind;
+		if (spec.type != 0 && !is_integer)
+			throw std::invalid_argument("ks_string_util::format(fmt, ...) invalid-format exception, the hex spec is only for integer");
+
+		piece->p = piece->number_chars;
+		piece->len = 0;
+		piece->is_signed = false;
+		switch (arg.kind) {
+		case kind_t::string_kind:
+			piece->p = arg.string_value.p;
+			piece->len = arg.string_value.len;
+			break;
+		case kind_t::char_kind:
+			piece->number_chars[0] = arg.char_value;
+			piece->len = 1;
+			break;
+		case kind_t::bool_kind:
+			piece->p = arg.bool_value ? s_true_chars : s_false_chars;
+			piece->len = arg.bool_value ? 4 : 5;
+			break;
+		case kind_t::int_kind:
+			if (spec.type != 0) {
+				const uint64_t abs_value = arg.int_value < 0 ? 0 - uint64_t(arg.int_value) : uint64_t(arg.int_value);
+				size_t n = 0;
+				if (arg.int_value < 0)
+					piece->number_chars[n++] = '-';
+				piece->len = n + uint64_to_hex_chars(abs_value, piece->number_chars + n, spec.type == 'X');
+			}
+			else {
+				piece->len = int64_to_chars(arg.int_value, piece->number_chars);
+			}
+			break;
+		case kind_t::uint_kind:
+			piece->len = spec.type != 0
+				? uint64_to_hex_chars(arg.uint_value, piece->number_chars, spec.type == 'X')
+				: uint64_to_chars(arg.uint_value, piece->number_chars);
+			break;
+		case kind_t::float_kind:
+			piece->len = float_to_chars(arg.float_value, piece->number_chars);
+			break;
+		case kind_t::double_kind:
+			piece->len = double_to_chars(arg.double_value, piece->number_chars);
+			break;
+		}
+
+		piece->pad_len = spec.width > piece->len ? spec.width - piece->len : 0;
+		piece->is_right_aligned = is_number;
+		piece->pad_ch = is_number && spec.is_zero_pad ? '0' : ' ';
+		piece->is_signed = is_number && piece->len != 0 && piece->p[0] == '-';
+	}
+
+	template <class ELEM>
+	static ELEM* __write_piece(ELEM* dst, const __format_piece<ELEM>& piece) {
+		const ELEM* src = piece.p;
+		size_t len = piece.len;
+		if (piece.is_right_aligned) {
+			if (piece.pad_ch == '0' && piece.is_signed) {
+				*dst++ = *src++;
+				--len;
+			}
+			dst = std::fill_n(dst, piece.pad_len, piece.pad_ch);
+			dst = std::copy_n(src, len, dst);
+		}
+		else {
+			dst = std::copy_n(src, len, dst);
+			dst = std::fill_n(dst, piece.pad_len, piece.pad_ch);
+		}
+		return dst;
+	}
+
+	//note:
+	// the 1st pass checks the format string, formats the args into pieces, and sums the total length,
+	// then the 2nd pass writes the literal parts and the pieces into the presized string.
+	// the pieces are given by the caller (on its stack, one per arg), so nothing is allocated but the output.
+	template <class ELEM>
+	static ks_basic_immutable_string<ELEM> __do_format_imp(const ks_basic_string_view<ELEM>& fmt, const __format_arg<ELEM>* args, size_t arg_count, __format_piece<ELEM>* pieces) {
+		const ELEM* const fmt_data = fmt.data();
+		const size_t fmt_len = fmt.length();
+
+		size_t total_len = 0;
+		size_t arg_index = 0;
+		for (size_t i = 0; i < fmt_len; ) {
+			const ELEM ch = fmt_data[i];
+			if ((ch == '{' || ch == '}') && i + 1 < fmt_len && fmt_data[i + 1] == ch) {
+				++total_len;
+				i += 2;
+			}
+			else if (ch == '{') {
+				const __format_spec spec = __parse_format_spec(fmt_data, fmt_len, i + 1);
+				if (spec.end == size_t(-1))
+					throw std::invalid_argument("ks_string_util::format(fmt, ...) invalid-format exception");
+				if (arg_index >= arg_count)
+					throw std::invalid_argument("ks_string_util::format(fmt, ...) invalid-format exception, too few args");
+				__format_piece<ELEM>* piece = &pieces[arg_index];
+				__format_piece_of(piece, args[arg_index], spec);
+				total_len += piece->len + piece->pad_len;
+				++arg_index;
+				i = spec.end;
+			}
+			else if (ch == '}') {
+				throw std::invalid_argument("ks_string_util::format(fmt, ...) invalid-format exception");
+			}
+			else {
+				++total_len;
+				++i;
+			}
+		}
+		if (arg_index != arg_count)
+			throw std::invalid_argument("ks_string_util::format(fmt, ...) invalid-format exception, too many args");
+
+		if (total_len == 0)
+			return ks_basic_immutable_string<ELEM>();
+
+		ks_basic_mutable_string<ELEM> ret;
+		ELEM* const ret_data = ret.__begin_exclusive_writing(total_len);
+		ELEM* dst = ret_data;
+		arg_index = 0;
+		for (size_t i = 0; i < fmt_len; ) {
+			const ELEM ch = fmt_data[i];
+			if ((ch == '{' || ch == '}') && i + 1 < fmt_len && fmt_data[i + 1] == ch) {
+				*dst++ = ch;
+				i += 2;
+			}
+			else if (ch == '{') {
+				dst = __write_piece(dst, pieces[arg_index++]);
+				i = __parse_format_spec(fmt_data, fmt_len, i + 1).end;
+			}
+			else {
+				//the literal run until the next brace
+				size_t run_end = i + 1;
+				while (run_end < fmt_len && fmt_data[run_end] != '{' && fmt_data[run_end] != '}')
+					++run_end;
+				dst = std::copy_n(fmt_data + i, run_end - i, dst);
+				i = run_end;
+			}
+		}
+		ASSERT(dst == ret_data + total_len);
+		ret.__end_exclusive_writing(ret_data, total_len);
+		return std::move(ret);
+	}
+
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	////////////////////////////////////////////////////////////////////////////////////////
+
+	MODERN_STRING_API
+	ks_immutable_string __do_format(const ks_string_view& fmt, const __format_arg<char>* args, size_t arg_count, __format_piece<char>* pieces) {
+		return __do_format_imp(fmt, args, arg_count, pieces);
+	}
+
+	MODERN_STRING_API
+	ks_immutable_wstring __do_format(const ks_wstring_view& fmt, const __format_arg<WCHAR>* args, size_t arg_count, __format_piece<WCHAR>* pieces) {
+		return __do_format_imp(fmt, args, arg_count, pieces);
+	}
+
+}
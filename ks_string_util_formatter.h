@@ -0,0 +1,271 @@
+﻿/* Copyright 2024 The Kingsoft's modern-string Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include "ks_string.h"
+#include "ks_number_chars.h"
+
+namespace ks_string_util {
+	//format ...
+	//the placeholder is {} (the args are taken in order), with an optional spec {:[0][width][x|X]},
+	//and {{ and }} are the escaped braces. e.g. format("{} = {:08x}", name, value)
+	//note:
+	// the args of string (anything convertible to the string-view), char, bool, integer and float types are formatted natively (no iostream),
+	// the number is right-aligned and padded with 0 or space by the width, and the others are left-aligned.
+	// the output is presized, so it is allocated only once.
+	// the format string wrapped by KS_FORMAT_STRING("...") is checked at compile time (the count of args as well),
+	// otherwise std::invalid_argument is thrown for the malformed format string or the mismatched args.
+	template <class... ARGS>
+	ks_immutable_string format(const ks_string_view& fmt, const ARGS&... args);
+	template <class... ARGS>
+	ks_immutable_wstring format(const ks_wstring_view& fmt, const ARGS&... args);
+
+	template <class ELEM, int ARG_COUNT>
+	struct __checked_format_string;
+	template <class ELEM, int ARG_COUNT, class... ARGS>
+	ks_basic_immutable_string<ELEM> format(const __checked_format_string<ELEM, ARG_COUNT>& fmt, const ARGS&... args);
+
+#define KS_FORMAT_STRING(s)  (::ks_string_util::__make_checked_format_string< ::ks_string_util::__count_format_args(s)>(s))
+
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	////////////////////////////////////////////////////////////////////////////////////////
+
+	struct __format_spec {
+		size_t end; //the position after the closing brace, or size_t(-1) if malformed
+		size_t width;
+		bool is_zero_pad;
+		char type; //0, 'x' or 'X'
+	};
+
+	//parse the spec of the placeholder, pos is just after the opening brace
+	template <class CH>
+	constexpr __format_spec __parse_format_spec(const CH* fmt, size_t len, size_t pos) {
+		__format_spec spec = { size_t(-1), 0, false, 0 };
+		if (pos < len && fmt[pos] == ':') {
+			++pos;
+			if (pos < len && fmt[pos] == '0') {
+				spec.is_zero_pad = true;
+				++pos;
+			}
+			while (pos < len && fmt[pos] >= '0' && fmt[pos] <= '9') {
+				spec.width = spec.width * 10 + size_t(fmt[pos] - '0');
+				if (spec.width > 0xFFFF)
+					return spec;
+				++pos;
+			}
+			if (pos < len && (fmt[pos] == 'x' || fmt[pos] == 'X')) {
+				spec.type = char(fmt[pos]);
+				++pos;
+			}
+		}
+		if (pos < len && fmt[pos] == '}')
+			spec.end = pos + 1;
+		return spec;
+	}
+
+	//count the placeholders of the format string, or -1 if it is malformed
+	template <class CH>
+	constexpr int __count_format_args(const CH* fmt, size_t len) {
+		int count = 0;
+		size_t i = 0;
+		while (i < len) {
+			if (fmt[i] == '{' && i + 1 < len && fmt[i + 1] == '{') {
+				i += 2;
+			}
+			else if (fmt[i] == '{') {
+				const __format_spec spec = __parse_format_spec(fmt, len, i + 1);
+				if (spec.end == size_t(-1))
+					return -1;
+				++count;
+				i = spec.end;
+			}
+			else if (fmt[i] == '}') {
+				if (i + 1 < len && fmt[i + 1] == '}')
+					i += 2;
+				else
+					return -1;
+			}
+			else {
+				++i;
+			}
+		}
+		return count;
+	}
+
+	template <class CH, size_t N>
+	constexpr int __count_format_args(const CH(&fmt)[N]) {
+		return __count_format_args(fmt, N - 1);
+	}
+
+	template <class ELEM, int ARG_COUNT>
+	struct __checked_format_string {
+		ks_basic_string_view<ELEM> str_view;
+	};
+
+	template <class CH>
+	struct __format_elem_of { using type = CH; };
+	template <>
+	struct __format_elem_of<char16_t> { using type = WCHAR; };
+	template <>
+	struct __format_elem_of<wchar_t> { using type = WCHAR; };
+
+	template <int ARG_COUNT, class CH, size_t N>
+	__checked_format_string<typename __format_elem_of<CH>::type, ARG_COUNT> __make_checked_format_string(const CH(&fmt)[N]) {
+		using ELEM = typename __format_elem_of<CH>::type;
+		static_assert(sizeof(CH) == sizeof(ELEM), "the char type of format string is invalid");
+		return __checked_format_string<ELEM, ARG_COUNT>{ ks_basic_string_view<ELEM>((const ELEM*)fmt, N - 1) };
+	}
+
+	//the type-erased arg
+	template <class ELEM>
+	struct __format_arg {
+		enum class kind_t : uint8_t { string_kind, char_kind, bool_kind, int_kind, uint_kind, float_kind, double_kind };
+
+		kind_t kind;
+		union {
+			struct { const ELEM* p; size_t len; } string_value;
+			ELEM char_value;
+			bool bool_value;
+			int64_t int_value;
+			uint64_t uint_value;
+			float float_value;
+			double double_value;
+		};
+	};
+
+	//the char types taken as a char, the narrow char is widened for the wide format,
+	//but not the unsigned short (which is WCHAR on some platforms), that is taken as an integer
+	template <class ELEM, class T>
+	struct __format_is_char : std::integral_constant<bool, std::is_same_v<T, char>> {};
+	template <>
+	struct __format_is_char<WCHAR, char16_t> : std::true_type {};
+	template <>
+	struct __format_is_char<WCHAR, wchar_t> : std::integral_constant<bool, sizeof(wchar_t) == sizeof(WCHAR)> {};
+
+	template <class T>
+	using __format_is_char_type = std::integral_constant<bool,
+		std::is_same_v<T, char> || std::is_same_v<T, char16_t> || std::is_same_v<T, char32_t> || std::is_same_v<T, wchar_t>>;
+
+	template <class ELEM, class T>
+	using __format_arg_kind_of = std::integral_constant<int,
+		std::is_convertible_v<const T&, ks_basic_string_view<ELEM>> ? 1
+		: __format_is_char<ELEM, T>::value ? 2
+		: __format_is_char_type<T>::value ? 0 //the char type which does not fit ELEM
+		: std::is_same_v<T, bool> ? 3
+		: std::is_integral_v<T> ? (std::is_signed_v<T> ? 4 : 5)
+		: std::is_same_v<T, float> ? 6
+		: std::is_same_v<T, double> ? 7
+		: 0>;
+
+	template <class ELEM, class T>
+	__format_arg<ELEM> __make_format_arg(const T& v, std::integral_constant<int, 0>) {
+		static_assert(!std::is_same_v<T, T>, "the arg type is not supported by format");
+		return __format_arg<ELEM>{};
+	}
+	template <class ELEM, class T>
+	__format_arg<ELEM> __make_format_arg(const T& v, std::integral_constant<int, 1>) {
+		const ks_basic_string_view<ELEM> str_view = v;
+		__format_arg<ELEM> arg;
+		arg.kind = __format_arg<ELEM>::kind_t::string_kind;
+		arg.string_value.p = str_view.data();
+		arg.string_value.len = str_view.length();
+		return arg;
+	}
+	template <class ELEM, class T>
+	__format_arg<ELEM> __make_format_arg(const T& v, std::integral_constant<int, 2>) {
+		__format_arg<ELEM> arg;
+		arg.kind = __format_arg<ELEM>::kind_t::char_kind;
+		arg.char_value = ELEM(std::make_unsigned_t<T>(v));
+		return arg;
+	}
+	template <class ELEM, class T>
+	__format_arg<ELEM> __make_format_arg(const T& v, std::integral_constant<int, 3>) {
+		__format_arg<ELEM> arg;
+		arg.kind = __format_arg<ELEM>::kind_t::bool_kind;
+		arg.bool_value = v;
+		return arg;
+	}
+	template <class ELEM, class T>
+	__format_arg<ELEM> __make_format_arg(const T& v, std::integral_constant<int, 4>) {
+		__format_arg<ELEM> arg;
+		arg.kind = __format_arg<ELEM>::kind_t::int_kind;
+		arg.int_value = (int64_t)v;
+		return arg;
+	}
+	template <class ELEM, class T>
+	__format_arg<ELEM> __make_format_arg(const T& v, std::integral_constant<int, 5>) {
+		__format_arg<ELEM> arg;
+		arg.kind = __format_arg<ELEM>::kind_t::uint_kind;
+		arg.uint_value = (uint64_t)v;
+		return arg;
+	}
+	template <class ELEM, class T>
+	__format_arg<ELEM> __make_format_arg(const T& v, std::integral_constant<int, 6>) {
+		__format_arg<ELEM> arg;
+		arg.kind = __format_arg<ELEM>::kind_t::float_kind;
+		arg.float_value = v;
+		return arg;
+	}
+	template <class ELEM, class T>
+	__format_arg<ELEM> __make_format_arg(const T& v, std::integral_constant<int, 7>) {
+		__format_arg<ELEM> arg;
+		arg.kind = __format_arg<ELEM>::kind_t::double_kind;
+		arg.double_value = v;
+		return arg;
+	}
+
+	//the formatted piece of one placeholder, the number is formatted into its own chars
+	template <class ELEM>
+	struct __format_piece {
+		const ELEM* p;
+		size_t len;
+		size_t pad_len;
+		ELEM pad_ch;
+		bool is_right_aligned;
+		bool is_signed; //if zero-padded, the zeros go after the sign
+		ELEM number_chars[max_number_chars];
+	};
+
+	MODERN_STRING_API
+	ks_immutable_string __do_format(const ks_string_view& fmt, const __format_arg<char>* args, size_t arg_count, __format_piece<char>* pieces);
+	MODERN_STRING_API
+	ks_immutable_wstring __do_format(const ks_wstring_view& fmt, const __format_arg<WCHAR>* args, size_t arg_count, __format_piece<WCHAR>* pieces);
+
+	template <class ELEM, class... ARGS>
+	ks_basic_immutable_string<ELEM> __format_with_args(const ks_basic_string_view<ELEM>& fmt, const ARGS&... args) {
+		const __format_arg<ELEM> arg_array[sizeof...(ARGS) + 1] = { __make_format_arg<ELEM>(args, __format_arg_kind_of<ELEM, ARGS>())..., __format_arg<ELEM>{} };
+		__format_piece<ELEM> pieces[sizeof...(ARGS) + 1];
+		return __do_format(fmt, arg_array, sizeof...(ARGS), pieces);
+	}
+
+	template <class... ARGS>
+	inline ks_immutable_string format(const ks_string_view& fmt, const ARGS&... args) {
+		return __format_with_args<char>(fmt, args...);
+	}
+
+	template <class... ARGS>
+	inline ks_immutable_wstring format(const ks_wstring_view& fmt, const ARGS&... args) {
+		return __format_with_args<WCHAR>(fmt, args...);
+	}
+
+	template <class ELEM, int ARG_COUNT, class... ARGS>
+	inline ks_basic_immutable_string<ELEM> format(const __checked_format_string<ELEM, ARG_COUNT>& fmt, const ARGS&... args) {
+		static_assert(ARG_COUNT >= 0, "the format string is malformed");
+		static_assert(ARG_COUNT == sizeof...(ARGS), "the count of args does not match the format string");
+		return __format_with_args<ELEM>(fmt.str_view, args...);
+	}
+}
@@ -14,6 +14,18 @@ limitations under the License.
 ==============================================================================*/
 
 #include "ks_string_util_parse.h"
+#include "ks_string_util_simd.h"
+#include "ks_string_util_pow5_table.h"
+#include <cstring>
+#include <cerrno>
+#include <limits>
+
+//the parse kernels are shared by parse_xxx, try_parse_xxx and the fields, and they must be inlined into each of them
+#if defined(_MSC_VER) && !defined(__clang__)
+#	define _KS_PARSE_INLINE  __forceinline
+#else
+#	define _KS_PARSE_INLINE  inline __attribute__((always_inline))
+#endif
 
 namespace ks_string_util {
 	template <class ELEM, class CH_PRED>
@@ -41,116 +53,515 @@ namespace ks_string_util {
 		}
 	}
 
-	static long long __strtointx(const char* ptr, char** endptr, int base, size_t type_size, bool is_signed) {
-		ASSERT(type_size <= sizeof(long long));
-		ASSERT(endptr != nullptr);
-		*endptr = const_cast<char*>(ptr);
+	//the value of a digit char in any base up to 36, or 99 for a non-digit char
+	template <class ELEM>
+	static inline uint __digit_value_of(ELEM ch) {
+		if (ch >= '0' && ch <= '9')
+			return uint(ch - '0');
+		else if (ch >= 'a' && ch <= 'z')
+			return uint(ch - 'a') + 10;
+		else if (ch >= 'A' && ch <= 'Z')
+			return uint(ch - 'A') + 10;
+		else
+			return 99;
+	}
 
-		long long parsed_val;
-		if (is_signed) {
-			if (type_size <= sizeof(long))
-				parsed_val = (long long)std::strtol(ptr, endptr, base);
-			else
-				parsed_val = (long long)std::strtoull(ptr, endptr, base);
+	//load 8 chars as 8 bytes (little-endian), a wide char above 0xFF becomes 0xFF (not a digit)
+	static inline uint64_t __load_8_chars_as_bytes(const char* p) {
+		uint64_t v;
+		memcpy(&v, p, 8);
+		return v;
+	}
+
+	static inline uint64_t __load_8_chars_as_bytes(const WCHAR* p) {
+#if _KS_SIMD_SSE2
+		__m128i v = _mm_loadu_si128((const __m128i*)p);
+		uint64_t v8;
+		_mm_storel_epi64((__m128i*)&v8, _mm_packus_epi16(v, v));
+		return v8;
+#else
+		uint64_t v = 0;
+		for (int i = 0; i < 8; ++i)
+			v |= uint64_t(p[i] <= 0xFF ? p[i] : 0xFF) << (i * 8);
+		return v;
+#endif
+	}
+
+	static inline bool __is_8_digits(uint64_t v) {
+		return (v & 0xF0F0F0F0F0F0F0F0) == 0x3030303030303030
+			&& ((v + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) == 0x3030303030303030;
+	}
+
+	//the swar way to convert 8 digits to the value, by 3 multiplications
+	static inline uint32_t __parse_8_digits(uint64_t v) {
+		v -= 0x3030303030303030;
+		v = (v * 10) + (v >> 8);
+		v = (((v & 0x000000FF000000FF) * (100 + (1000000ULL << 32)))
+			+ (((v >> 16) & 0x000000FF000000FF) * (1 + (10000ULL << 32)))) >> 32;
+		return (uint32_t)v;
+	}
+
+	template <class VALUE_TYPE>
+	static inline parse_result<VALUE_TYPE> __parse_error_result(parse_error error) {
+		return parse_result<VALUE_TYPE>{ VALUE_TYPE(0), 0, error };
+	}
+
+	//note:
+	// the rule is the same as strtol, except that no leading space is skipped:
+	// an optional sign, then the prefix 0x/0X for base 16 (or base 0), and the leading 0 means octal for base 0.
+	// a negative value is out of range for the unsigned types (but -0 is 0).
+	// the error is told by the result: empty if pos is at the end, invalid if no digit is taken, or overflow if the value is out of range.
+	template <class INT_TYPE, class ELEM>
+	static _KS_PARSE_INLINE parse_result<INT_TYPE> __try_parse_intx(const ks_basic_string_view<ELEM>& str_view, size_t pos, int base) {
+		static_assert(std::is_integral_v<INT_TYPE>, "the INT_TYPE is invalid");
+		using UINT_TYPE = std::make_unsigned_t<INT_TYPE>;
+		if (pos >= str_view.length())
+			return __parse_error_result<INT_TYPE>(parse_error::empty);
+		if (base < 0 || base == 1 || base > 36)
+			return __parse_error_result<INT_TYPE>(parse_error::invalid);
+
+		const ELEM* const str_data = str_view.data();
+		const ELEM* const str_end = str_data + str_view.length();
+		const ELEM* p = str_data + pos;
+
+		bool is_negative = false;
+		if (p < str_end && (*p == '+' || *p == '-')) {
+			is_negative = *p == '-';
+			++p;
 		}
-		else {
-			if (type_size <= sizeof(long))
-				parsed_val = (long long)std::strtoul(ptr, endptr, base);
-			else
-				parsed_val = (long long)std::strtoull(ptr, endptr, base);
+
+		if ((base == 0 || base == 16) && str_end - p >= 3 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X') && __digit_value_of(p[2]) < 16) {
+			p += 2;
+			base = 16;
 		}
+		else if (base == 0) {
+			base = (p < str_end && *p == '0') ? 8 : 10;
+		}
+
+		//the magnitude limit of the type, and the cutoff to detect overflow before it happens
+		const uint64_t limit = std::is_signed_v<INT_TYPE>
+			? (uint64_t)(UINT_TYPE(-1) >> 1) + (is_negative ? 1 : 0)
+			: (is_negative ? 0 : (uint64_t)UINT_TYPE(-1));
+		const uint64_t cutoff = base == 10 ? limit / 10 : limit / (uint)base; //the constant divisor is cheaper for the most common base
+		const uint cutlim = uint(limit - cutoff * (uint)base);
+
+		const ELEM* const digits_begin = p;
+		uint64_t value = 0;
+		bool is_overflow = false;
 
-		if (*endptr > ptr && errno != ERANGE && type_size < sizeof(long)) {
-			//check bits range
-			const long long max_legal_value = is_signed ? (long long)(((unsigned long long)1 << (type_size * 8 - 1)) - 1) : ((long long)1 << type_size * 8) - 1;
-			const long long min_legal_value = is_signed ? ~max_legal_value : 0;
-			if (parsed_val < min_legal_value || parsed_val > max_legal_value) 
-				errno = ERANGE;
+		if (base == 10 && limit >= 99999999) {
+			//8 digits at once while the value can never overflow
+			const uint64_t swar_cutoff = (limit - 99999999) / 100000000;
+			while (str_end - p >= 8 && value <= swar_cutoff) {
+				uint64_t v = __load_8_chars_as_bytes(p);
+				if (!__is_8_digits(v))
+					break;
+				value = value * 100000000 + __parse_8_digits(v);
+				p += 8;
+			}
+		}
+
+		for (; p < str_end; ++p) {
+			uint digit = __digit_value_of(*p);
+			if (digit >= (uint)base)
+				break;
+			if (value > cutoff || (value == cutoff && digit > cutlim))
+				is_overflow = true; //the digits are still taken, like strtol
+			else
+				value = value * (uint)base + digit;
 		}
 
-		return parsed_val;
+		if (p == digits_begin)
+			return __parse_error_result<INT_TYPE>(parse_error::invalid);
+		if (is_overflow)
+			return __parse_error_result<INT_TYPE>(parse_error::overflow);
+
+		return parse_result<INT_TYPE>{ (INT_TYPE)(UINT_TYPE)(is_negative ? 0 - value : value), size_t(p - (str_data + pos)), parse_error::none };
 	}
 
+	//if error, the def_value is returned and *pos is not changed.
 	template <class INT_TYPE, class ELEM>
-	static INT_TYPE __do_parse_intx(const ks_basic_string_view<ELEM>& str_view, INT_TYPE def_value, size_t* pos, int base) {
-		static_assert(std::is_integral_v<INT_TYPE>, "the INT_TYPE is invalid");
-		if (pos != nullptr && *pos >= str_view.length())
+	static inline INT_TYPE __do_parse_intx(const ks_basic_string_view<ELEM>& str_view, INT_TYPE def_value, size_t* pos, int base) {
+		const parse_result<INT_TYPE> result = __try_parse_intx<INT_TYPE>(str_view, pos != nullptr ? *pos : 0, base);
+		if (result.error != parse_error::none)
 			return def_value;
+		if (pos != nullptr)
+			*pos += result.consumed;
+		return result.value;
+	}
 
-		ks_basic_string_view<ELEM> str_view2 = pos != nullptr && *pos != 0 ? str_view.substr(*pos, -1) : str_view;
+	namespace __float_parse {
+		//the binary format params of the float types, for the decimal-to-binary conversion
+		template <class FLOAT_TYPE>
+		struct __binary_format;
 
-		std::string buff;
-		constexpr size_t len_limit = sizeof(INT_TYPE) * 8 + 10;
-		if (base != 0 && base <= 10) {
-			__do_prepare_buff_for_parse(&buff, str_view2, len_limit, ';', [](char ch) -> bool {
-				return (ch >= '0' && ch <= '9')
-					|| (ch == '+') || (ch == '-');
-				});
+		template <>
+		struct __binary_format<double> {
+			using bits_type = uint64_t;
+			static constexpr int mantissa_explicit_bits = 52;
+			static constexpr int minimum_exponent = -1023;
+			static constexpr int infinite_power = 0x7FF;
+			static constexpr int smallest_power_of_ten = -342;
+			static constexpr int largest_power_of_ten = 308;
+			static constexpr int min_exponent_round_to_even = -4;
+			static constexpr int max_exponent_round_to_even = 23;
+			static constexpr int max_exponent_fast_path = 22;
+			static constexpr uint64_t max_mantissa_fast_path = uint64_t(2) << 52;
+
+			static double exact_power_of_ten(int e) {
+				static const double s_table[] = {
+					1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+					1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+				return s_table[e];
+			}
+		};
+
+		template <>
+		struct __binary_format<float> {
+			using bits_type = uint32_t;
+			static constexpr int mantissa_explicit_bits = 23;
+			static constexpr int minimum_exponent = -127;
+			static constexpr int infinite_power = 0xFF;
+			static constexpr int smallest_power_of_ten = -65;
+			static constexpr int largest_power_of_ten = 38;
+			static constexpr int min_exponent_round_to_even = -17;
+			static constexpr int max_exponent_round_to_even = 10;
+			static constexpr int max_exponent_fast_path = 10;
+			static constexpr uint64_t max_mantissa_fast_path = uint64_t(2) << 23;
+
+			static float exact_power_of_ten(int e) {
+				static const float s_table[] = { 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+				return s_table[e];
+			}
+		};
+
+		struct __u128 {
+			uint64_t low;
+			uint64_t high;
+		};
+
+		static inline __u128 __full_multiply(uint64_t a, uint64_t b) {
+			__u128 r;
+			r.low = __simd::umul128(a, b, &r.high);
+			return r;
 		}
-		else {
-			__do_prepare_buff_for_parse(&buff, str_view2, len_limit, ';', [](char ch) -> bool {
-				return (ch >= '0' && ch <= '9')
-					|| (ch >= 'a' && ch <= 'z')
-					|| (ch >= 'A' && ch <= 'Z')
-					|| (ch == '+') || (ch == '-');
-				});
+
+		//the result of eisel-lemire: the mantissa (without the implicit bit) and the biased exponent,
+		//power2 < 0 means the result can not be decided, and the fallback is needed
+		struct __adjusted_mantissa {
+			uint64_t mantissa;
+			int power2;
+		};
+
+		//compute w * 10^q to the nearest float by the 128-bit approximation of 5^q (the eisel-lemire algorithm)
+		template <class FLOAT_TYPE>
+		static __adjusted_mantissa __compute_float(int64_t q, uint64_t w) {
+			using _BINARY = __binary_format<FLOAT_TYPE>;
+			constexpr int mbits = _BINARY::mantissa_explicit_bits;
+			if (w == 0 || q < _BINARY::smallest_power_of_ten)
+				return __adjusted_mantissa{ 0, 0 };
+			if (q > _BINARY::largest_power_of_ten)
+				return __adjusted_mantissa{ 0, _BINARY::infinite_power };
+
+			const int lz = (int)__simd::clz64(w);
+			w <<= lz;
+
+			//the product of w and 5^q, only the high bits are needed, and the second half of 5^q is only used when the first product is not precise enough
+			const int index = 2 * int(q - __pow5_table_min_q);
+			__u128 product = __full_multiply(w, __pow5_128_table[index]);
+			constexpr uint64_t precision_mask = uint64_t(-1) >> (mbits + 3);
+			if ((product.high & precision_mask) == precision_mask) {
+				__u128 second = __full_multiply(w, __pow5_128_table[index + 1]);
+				product.low += second.high;
+				if (second.high > product.low)
+					product.high++;
+				if (product.low == uint64_t(-1) && (q < -27 || q > 55))
+					return __adjusted_mantissa{ 0, -1 }; //still ambiguous
+			}
+
+			const int upperbit = int(product.high >> 63);
+			const int shift = upperbit + 64 - mbits - 3;
+			__adjusted_mantissa answer;
+			answer.mantissa = product.high >> shift;
+			//note: (((152170 + 65536) * q) >> 16) + 63 is floor(q * log2(10)) + 63 for q in [-342, 308]
+			answer.power2 = int((((152170 + 65536) * (int)q) >> 16) + 63) + upperbit - lz - _BINARY::minimum_exponent;
+
+			if (answer.power2 <= 0) {
+				//subnormal (or zero)
+				if (-answer.power2 + 1 >= 64)
+					return __adjusted_mantissa{ 0, 0 };
+				answer.mantissa >>= -answer.power2 + 1;
+				answer.mantissa += (answer.mantissa & 1);
+				answer.mantissa >>= 1;
+				//it may become the smallest normal after rounding
+				answer.power2 = answer.mantissa < (uint64_t(1) << mbits) ? 0 : 1;
+				return answer;
+			}
+
+			//the exact halfway case (only possible for small q), which is rounded to even
+			if (product.low <= 1 && q >= _BINARY::min_exponent_round_to_even && q <= _BINARY::max_exponent_round_to_even
+				&& (answer.mantissa & 3) == 1 && (answer.mantissa << shift) == product.high) {
+				answer.mantissa &= ~uint64_t(1);
+			}
+
+			answer.mantissa += (answer.mantissa & 1);
+			answer.mantissa >>= 1;
+			if (answer.mantissa >= (uint64_t(2) << mbits)) {
+				answer.mantissa = uint64_t(1) << mbits;
+				answer.power2++;
+			}
+			answer.mantissa &= ~(uint64_t(1) << mbits);
+			if (answer.power2 >= _BINARY::infinite_power)
+				return __adjusted_mantissa{ 0, _BINARY::infinite_power };
+			return answer;
 		}
-		
-		const char* ptr = buff.c_str();
-		if (ptr[0] == 0)
-			return def_value;
 
-		char* endptr = const_cast<char*>(ptr);
-		INT_TYPE parsed_value = (INT_TYPE)__strtointx(buff.c_str(), &endptr, base, sizeof(INT_TYPE), std::is_signed_v<INT_TYPE>);
-		bool has_error = endptr <= ptr || errno == ERANGE;
-		if (has_error)
-			return def_value;
+		//convert w * 10^q (w is the first 19 significant digits) to the float,
+		//returns false if it can not be decided (then the fallback is needed)
+		template <class FLOAT_TYPE>
+		static bool __decimal_to_float(uint64_t w, int64_t q, bool is_truncated, FLOAT_TYPE* value, bool* is_out_of_range) {
+			using _BINARY = __binary_format<FLOAT_TYPE>;
+			ASSERT(w != 0);
 
-		if (pos != nullptr)
-			*pos = str_view2.data() + (endptr - ptr) - str_view.data();
-		return parsed_value;
+			//the clinger fast-path: both w and 10^|q| are exact in the float type, so one multiplication or division is correctly rounded
+			if (!is_truncated && q >= -_BINARY::max_exponent_fast_path && q <= _BINARY::max_exponent_fast_path && w <= _BINARY::max_mantissa_fast_path) {
+				*value = q < 0
+					? FLOAT_TYPE(w) / _BINARY::exact_power_of_ten(int(-q))
+					: FLOAT_TYPE(w) * _BINARY::exact_power_of_ten(int(q));
+				*is_out_of_range = false;
+				return true;
+			}
+
+			__adjusted_mantissa am = __compute_float<FLOAT_TYPE>(q, w);
+			if (am.power2 < 0)
+				return false;
+			if (is_truncated) {
+				//the dropped digits are between w and w+1, so the result is decided only if both give the same
+				__adjusted_mantissa am2 = __compute_float<FLOAT_TYPE>(q, w + 1);
+				if (am2.power2 != am.power2 || am2.mantissa != am.mantissa)
+					return false;
+			}
+
+			typename _BINARY::bits_type bits = typename _BINARY::bits_type(am.mantissa | (uint64_t(am.power2) << _BINARY::mantissa_explicit_bits));
+			static_assert(sizeof(bits) == sizeof(FLOAT_TYPE), "the bits_type is invalid");
+			memcpy(value, &bits, sizeof(bits));
+			//note: like strtod, both the overflow and the underflow (to zero or subnormal) are out of range
+			*is_out_of_range = am.power2 == 0 || am.power2 == _BINARY::infinite_power;
+			return true;
+		}
+
+		//the fallback by strtod/strtof, the buff has no decimal point so that it is not locale-dependent
+		static inline bool __strtox_of_buff(const char* buff, float* value) {
+			char* endptr = nullptr;
+			errno = 0;
+			*value = std::strtof(buff, &endptr);
+			return endptr != buff && *endptr == 0 && errno != ERANGE;
+		}
+
+		static inline bool __strtox_of_buff(const char* buff, double* value) {
+			char* endptr = nullptr;
+			errno = 0;
+			*value = std::strtod(buff, &endptr);
+			return endptr != buff && *endptr == 0 && errno != ERANGE;
+		}
+
+		//match the word case-insensitively, returns the count of the matched chars
+		template <class ELEM>
+		static inline size_t __match_word_icase(const ELEM* p, const ELEM* end, const char* word) {
+			size_t n = 0;
+			while (word[n] != 0 && p + n < end && (p[n] == word[n] || p[n] == word[n] - 'a' + 'A'))
+				++n;
+			return n;
+		}
+
+		//take a run of decimal digits, up to 19 significant digits are kept in the mantissa, and the rest only mark whether it is truncated
+		template <class ELEM>
+		static inline const ELEM* __take_decimal_digits(const ELEM* p, const ELEM* end, uint64_t* mantissa, int* kept_digits, bool* is_truncated) {
+			while (*kept_digits <= 19 - 8 && end - p >= 8) {
+				uint64_t v = __load_8_chars_as_bytes(p);
+				if (!__is_8_digits(v))
+					break;
+				*mantissa = *mantissa * 100000000 + __parse_8_digits(v);
+				*kept_digits += 8;
+				p += 8;
+			}
+
+			for (; p < end && uint(*p - '0') < 10; ++p) {
+				if (*kept_digits < 19) {
+					*mantissa = *mantissa * 10 + uint(*p - '0');
+					++*kept_digits;
+				}
+				else if (*p != '0') {
+					*is_truncated = true;
+				}
+			}
+			return p;
+		}
+
+		//take the exponent part (e.g. e-5 or p+3) if there is, the huge exponent is clamped (it is out of range anyway)
+		template <class ELEM>
+		static inline const ELEM* __take_exponent(const ELEM* p, const ELEM* end, char exp_ch, int64_t* exp_val) {
+			*exp_val = 0;
+			if (p == end || (*p != exp_ch && *p != exp_ch - 'a' + 'A'))
+				return p;
+			const ELEM* q = p + 1;
+			bool is_negative = false;
+			if (q < end && (*q == '+' || *q == '-')) {
+				is_negative = *q == '-';
+				++q;
+			}
+			if (q == end || uint(*q - '0') >= 10)
+				return p; //no digit, the exponent part is not taken
+
+			int64_t e = 0;
+			for (; q < end && uint(*q - '0') < 10; ++q) {
+				if (e < 0x10000000)
+					e = e * 10 + uint(*q - '0');
+			}
+			*exp_val = is_negative ? -e : e;
+			return q;
+		}
+
+		//the hex-float is rare, so it is always converted by strtod
+		template <class FLOAT_TYPE, class ELEM>
+		static const ELEM* __parse_hex_float(const ELEM* p, const ELEM* end, FLOAT_TYPE* value) {
+			ASSERT(end - p >= 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X'));
+			std::string buff = "0x";
+			p += 2;
+			int64_t frac_digits = 0;
+			for (; p < end && __digit_value_of(*p) < 16; ++p)
+				buff.append(1, (char)*p);
+			if (p < end && *p == '.') {
+				for (++p; p < end && __digit_value_of(*p) < 16; ++p) {
+					buff.append(1, (char)*p);
+					++frac_digits;
+				}
+			}
+			ASSERT(buff.length() > 2);
+
+			int64_t exp_val;
+			p = __take_exponent(p, end, 'p', &exp_val);
+			buff.append(1, 'p');
+			buff.append(std::to_string(exp_val - frac_digits * 4));
+			return __strtox_of_buff(buff.c_str(), value) ? p : nullptr;
+		}
 	}
 
+	//note:
+	// the rule is the same as strtod, except that no leading space is skipped and the decimal point is always '.' (not locale-dependent):
+	// an optional sign, then the decimal digits with an optional fraction and exponent, or a hex-float (0x...p...), or inf/infinity/nan.
+	// the error is told by the result: empty if pos is at the end, invalid if no digit is taken, or overflow if the value is out of range (overflow or underflow).
+	// the decimal is converted by the clinger fast-path or the eisel-lemire algorithm, and strtod is only the fallback of the rare cases.
 	template <class FLOAT_TYPE, class ELEM>
-	static FLOAT_TYPE __do_parse_floatx(const ks_basic_string_view<ELEM>& str_view, FLOAT_TYPE def_value, size_t* pos) {
-		static_assert(std::is_floating_point_v<FLOAT_TYPE>, "the FLOAT_TYPE is invalid");
-		if (pos != nullptr && *pos >= str_view.length())
-			return def_value;
+	static _KS_PARSE_INLINE parse_result<FLOAT_TYPE> __try_parse_floatx(const ks_basic_string_view<ELEM>& str_view, size_t pos) {
+		static_assert(std::is_same_v<FLOAT_TYPE, float> || std::is_same_v<FLOAT_TYPE, double>, "the FLOAT_TYPE is invalid");
+		using namespace __float_parse;
+		if (pos >= str_view.length())
+			return __parse_error_result<FLOAT_TYPE>(parse_error::empty);
 
-		ks_basic_string_view<ELEM> str_view2 = pos != nullptr && *pos != 0 ? str_view.substr(*pos, -1) : str_view;
+		const ELEM* const str_data = str_view.data();
+		const ELEM* const str_end = str_data + str_view.length();
+		const ELEM* p = str_data + pos;
 
-		std::string buff;
-		__do_prepare_buff_for_parse(&buff, str_view2, str_view2.length(), ';', [](char ch) -> bool {
-			return (ch >= '0' && ch <= '9')
-				|| (ch >= 'a' && ch <= 'z')
-				|| (ch >= 'A' && ch <= 'Z')
-				|| (ch == '+') || (ch == '-')
-				|| (ch == '.');
-			});
+		bool is_negative = false;
+		if (p < str_end && (*p == '+' || *p == '-')) {
+			is_negative = *p == '-';
+			++p;
+		}
 
-		const char* ptr = buff.c_str();
-		if (ptr[0] == 0)
-			return def_value;
+		FLOAT_TYPE value = 0;
+		if (p < str_end && (*p == 'i' || *p == 'I' || *p == 'n' || *p == 'N')) {
+			//inf, infinity or nan
+			const size_t inf_len = __match_word_icase(p, str_end, "infinity");
+			if (inf_len >= 3) {
+				p += inf_len == 8 ? 8 : 3;
+				value = std::numeric_limits<FLOAT_TYPE>::infinity();
+			}
+			else if (__match_word_icase(p, str_end, "nan") == 3) {
+				p += 3;
+				value = std::numeric_limits<FLOAT_TYPE>::quiet_NaN();
+			}
+			else {
+				return __parse_error_result<FLOAT_TYPE>(parse_error::invalid);
+			}
+		}
+		else if (str_end - p >= 3 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X')
+			&& (__digit_value_of(p[2]) < 16 || (str_end - p >= 4 && p[2] == '.' && __digit_value_of(p[3]) < 16))) {
+			p = __parse_hex_float(p, str_end, &value);
+			if (p == nullptr)
+				return __parse_error_result<FLOAT_TYPE>(parse_error::overflow);
+		}
+		else {
+			uint64_t mantissa = 0;
+			int kept_digits = 0;
+			bool is_truncated = false;
+			bool has_digit = false;
 
-		FLOAT_TYPE parsed_val = 0;
-		char* endptr = const_cast<char*>(ptr);
-		if (std::is_same_v<FLOAT_TYPE, float>)
-			parsed_val = (FLOAT_TYPE)std::strtof(ptr, &endptr);
-		else if (std::is_same_v<FLOAT_TYPE, double>)
-			parsed_val = (FLOAT_TYPE)std::strtod(ptr, &endptr);
-		else if (std::is_same_v<FLOAT_TYPE, long double>)
-			parsed_val = (FLOAT_TYPE)std::strtold(ptr, &endptr);
-		else
-			ASSERT(false);
+			//the integer part, the leading zeros are not significant
+			const ELEM* const int_begin = p;
+			while (p < str_end && *p == '0')
+				++p;
+			const ELEM* const int_sig_begin = p;
+			p = __take_decimal_digits(p, str_end, &mantissa, &kept_digits, &is_truncated);
+			const ELEM* const int_end = p;
+			has_digit = int_end != int_begin;
+			int64_t exponent = int64_t(int_end - int_sig_begin) - kept_digits; //the dropped digits of integer part
 
-		bool has_error = endptr <= ptr || errno == ERANGE;
-		if (has_error)
-			return def_value;
+			//the fraction part
+			const ELEM* frac_begin = p;
+			if (p < str_end && *p == '.') {
+				++p;
+				frac_begin = p;
+				if (kept_digits == 0) {
+					while (p < str_end && *p == '0')
+						++p;
+					exponent -= p - frac_begin;
+				}
+				const int kept_digits_before = kept_digits;
+				p = __take_decimal_digits(p, str_end, &mantissa, &kept_digits, &is_truncated);
+				exponent -= kept_digits - kept_digits_before;
+				has_digit = has_digit || p != frac_begin;
+			}
+			const ELEM* const frac_end = p;
+
+			if (!has_digit)
+				return __parse_error_result<FLOAT_TYPE>(parse_error::invalid);
+
+			int64_t exp_val;
+			p = __take_exponent(p, str_end, 'e', &exp_val);
+			exponent += exp_val;
+
+			bool is_out_of_range = false;
+			if (mantissa != 0 && !__decimal_to_float(mantissa, exponent, is_truncated, &value, &is_out_of_range)) {
+				//the fallback: all digits (without the decimal point) and the adjusted exponent
+				std::string buff;
+				buff.reserve((int_end - int_begin) + (frac_end - frac_begin) + 24);
+				for (const ELEM* it = int_begin; it != int_end; ++it)
+					buff.append(1, (char)*it);
+				for (const ELEM* it = frac_begin; it != frac_end; ++it)
+					buff.append(1, (char)*it);
+				buff.append(1, 'e');
+				buff.append(std::to_string(exp_val - int64_t(frac_end - frac_begin)));
+				if (!__strtox_of_buff(buff.c_str(), &value))
+					return __parse_error_result<FLOAT_TYPE>(parse_error::overflow);
+			}
+			if (is_out_of_range)
+				return __parse_error_result<FLOAT_TYPE>(parse_error::overflow);
+		}
 
 		//parse ok
+		return parse_result<FLOAT_TYPE>{ is_negative ? -value : value, size_t(p - (str_data + pos)), parse_error::none };
+	}
+
+	//if error, the def_value is returned and *pos is not changed.
+	template <class FLOAT_TYPE, class ELEM>
+	static inline FLOAT_TYPE __do_parse_floatx(const ks_basic_string_view<ELEM>& str_view, FLOAT_TYPE def_value, size_t* pos) {
+		const parse_result<FLOAT_TYPE> result = __try_parse_floatx<FLOAT_TYPE>(str_view, pos != nullptr ? *pos : 0);
+		if (result.error != parse_error::none)
+			return def_value;
 		if (pos != nullptr)
-			*pos = str_view2.data() + (endptr - ptr) - str_view.data();
-		return parsed_val;
+			*pos += result.consumed;
+		return result.value;
 	}
 
 	template <class BOOL_TYPE, class ELEM>
@@ -212,6 +623,107 @@ namespace ks_string_util {
 	}
 
 
+	//find the delim from p, return end if not found
+	static const char* __find_delim(const char* p, const char* end, char delim) {
+#if _KS_SIMD_SSE2
+		const __m128i v_delim = _mm_set1_epi8(delim);
+		for (; end - p >= 16; p += 16) {
+			uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)p), v_delim));
+			if (mask != 0)
+				return p + __simd::ctz32(mask);
+		}
+#endif
+		for (; p < end; ++p) {
+			if (*p == delim)
+				return p;
+		}
+		return end;
+	}
+
+	static const WCHAR* __find_delim(const WCHAR* p, const WCHAR* end, WCHAR delim) {
+#if _KS_SIMD_SSE2
+		const __m128i v_delim = _mm_set1_epi16((short)delim);
+		for (; end - p >= 8; p += 8) {
+			uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_loadu_si128((const __m128i*)p), v_delim));
+			if (mask != 0)
+				return p + __simd::ctz32(mask) / 2;
+		}
+#endif
+		for (; p < end; ++p) {
+			if (*p == delim)
+				return p;
+		}
+		return end;
+	}
+
+	//note:
+	// if the delim may be taken by a number (a letter, a digit, a sign or the point), each field is bounded by searching the delim first.
+	// otherwise, the number is parsed in place and the delim is expected just after it, so the delim is searched only for the invalid fields.
+	template <class VALUE_TYPE, class ELEM, class PARSE_FN>
+	static parse_fields_result __do_parse_fields(const ks_basic_string_view<ELEM>& str_view, ELEM delim, VALUE_TYPE* out, size_t out_capacity, VALUE_TYPE def_value, std::vector<size_t>* error_positions, PARSE_FN parse_fn) {
+		parse_fields_result result = { 0, 0, size_t(-1), 0 };
+		const ELEM* const str_data = str_view.data();
+		const ELEM* const str_end = str_data + str_view.length();
+		const bool is_delim_maybe_taken = __digit_value_of(delim) < 36 || delim == '+' || delim == '-' || delim == '.';
+
+		const ELEM* p = str_data;
+		while (p < str_end && result.field_count < out_capacity) {
+			const ELEM* field_end;
+			size_t taken_len = 0;
+			VALUE_TYPE value;
+			bool is_valid;
+			if (is_delim_maybe_taken) {
+				field_end = __find_delim(p, str_end, delim);
+				value = parse_fn(ks_basic_string_view<ELEM>(p, field_end - p), &taken_len);
+				is_valid = taken_len != 0 && p + taken_len == field_end;
+			}
+			else {
+				value = parse_fn(ks_basic_string_view<ELEM>(p, str_end - p), &taken_len);
+				field_end = p + taken_len;
+				is_valid = taken_len != 0 && (field_end == str_end || *field_end == delim);
+				if (!is_valid)
+					field_end = __find_delim(p, str_end, delim);
+			}
+
+			if (is_valid) {
+				out[result.field_count] = value;
+			}
+			else {
+				out[result.field_count] = def_value;
+				if (result.error_count == 0)
+					result.first_error_pos = p - str_data;
+				++result.error_count;
+				if (error_positions != nullptr)
+					error_positions->push_back(p - str_data);
+			}
+			++result.field_count;
+
+			p = field_end;
+			if (p < str_end)
+				++p; //skip the delim
+		}
+
+		result.end_pos = p - str_data;
+		return result;
+	}
+
+	template <class INT_TYPE, class ELEM>
+	static parse_fields_result __do_parse_int_fields(const ks_basic_string_view<ELEM>& str_view, ELEM delim, INT_TYPE* out, size_t out_capacity, INT_TYPE def_value, int base, std::vector<size_t>* error_positions) {
+		return __do_parse_fields(str_view, delim, out, out_capacity, def_value, error_positions,
+			[def_value, base](const ks_basic_string_view<ELEM>& field_view, size_t* pos) -> INT_TYPE {
+				return __do_parse_intx<INT_TYPE>(field_view, def_value, pos, base);
+			});
+	}
+
+	template <class FLOAT_TYPE, class ELEM>
+	static parse_fields_result __do_parse_float_fields(const ks_basic_string_view<ELEM>& str_view, ELEM delim, FLOAT_TYPE* out, size_t out_capacity, FLOAT_TYPE def_value, std::vector<size_t>* error_positions) {
+		return __do_parse_fields(str_view, delim, out, out_capacity, def_value, error_positions,
+			[def_value](const ks_basic_string_view<ELEM>& field_view, size_t* pos) -> FLOAT_TYPE {
+				return __do_parse_floatx<FLOAT_TYPE>(field_view, def_value, pos);
+			});
+	}
+
+
 	////////////////////////////////////////////////////////////////////////////////////////
 	////////////////////////////////////////////////////////////////////////////////////////
 
@@ -354,4 +866,186 @@ namespace ks_string_util {
 		return __do_parse_boolx<bool>(str_view, def_value, pos);
 	}
 
+	//parse fields ...
+	MODERN_STRING_API
+	parse_fields_result parse_int32_fields(const ks_string_view& str_view, char delim, int32_t* out, size_t out_capacity, int32_t def_value, int base, std::vector<size_t>* error_positions) {
+		return __do_parse_int_fields<int32_t>(str_view, delim, out, out_capacity, def_value, base, error_positions);
+	}
+	MODERN_STRING_API
+	parse_fields_result parse_int32_fields(const ks_wstring_view& str_view, WCHAR delim, int32_t* out, size_t out_capacity, int32_t def_value, int base, std::vector<size_t>* error_positions) {
+		return __do_parse_int_fields<int32_t>(str_view, delim, out, out_capacity, def_value, base, error_positions);
+	}
+
+	MODERN_STRING_API
+	parse_fields_result parse_int64_fields(const ks_string_view& str_view, char delim, int64_t* out, size_t out_capacity, int64_t def_value, int base, std::vector<size_t>* error_positions) {
+		return __do_parse_int_fields<int64_t>(str_view, delim, out, out_capacity, def_value, base, error_positions);
+	}
+	MODERN_STRING_API
+	parse_fields_result parse_int64_fields(const ks_wstring_view& str_view, WCHAR delim, int64_t* out, size_t out_capacity, int64_t def_value, int base, std::vector<size_t>* error_positions) {
+		return __do_parse_int_fields<int64_t>(str_view, delim, out, out_capacity, def_value, base, error_positions);
+	}
+
+	MODERN_STRING_API
+	parse_fields_result parse_uint32_fields(const ks_string_view& str_view, char delim, uint32_t* out, size_t out_capacity, uint32_t def_value, int base, std::vector<size_t>* error_positions) {
+		return __do_parse_int_fields<uint32_t>(str_view, delim, out, out_capacity, def_value, base, error_positions);
+	}
+	MODERN_STRING_API
+	parse_fields_result parse_uint32_fields(const ks_wstring_view& str_view, WCHAR delim, uint32_t* out, size_t out_capacity, uint32_t def_value, int base, std::vector<size_t>* error_positions) {
+		return __do_parse_int_fields<uint32_t>(str_view, delim, out, out_capacity, def_value, base, error_positions);
+	}
+
+	MODERN_STRING_API
+	parse_fields_result parse_uint64_fields(const ks_string_view& str_view, char delim, uint64_t* out, size_t out_capacity, uint64_t def_value, int base, std::vector<size_t>* error_positions) {
+		return __do_parse_int_fields<uint64_t>(str_view, delim, out, out_capacity, def_value, base, error_positions);
+	}
+	MODERN_STRING_API
+	parse_fields_result parse_uint64_fields(const ks_wstring_view& str_view, WCHAR delim, uint64_t* out, size_t out_capacity, uint64_t def_value, int base, std::vector<size_t>* error_positions) {
+		return __do_parse_int_fields<uint64_t>(str_view, delim, out, out_capacity, def_value, base, error_positions);
+	}
+
+	MODERN_STRING_API
+	parse_fields_result parse_float_fields(const ks_string_view& str_view, char delim, float* out, size_t out_capacity, float def_value, std::vector<size_t>* error_positions) {
+		return __do_parse_float_fields<float>(str_view, delim, out, out_capacity, def_value, error_positions);
+	}
+	MODERN_STRING_API
+	parse_fields_result parse_float_fields(const ks_wstring_view& str_view, WCHAR delim, float* out, size_t out_capacity, float def_value, std::vector<size_t>* error_positions) {
+		return __do_parse_float_fields<float>(str_view, delim, out, out_capacity, def_value, error_positions);
+	}
+
+	MODERN_STRING_API
+	parse_fields_result parse_double_fields(const ks_string_view& str_view, char delim, double* out, size_t out_capacity, double def_value, std::vector<size_t>* error_positions) {
+		return __do_parse_float_fields<double>(str_view, delim, out, out_capacity, def_value, error_positions);
+	}
+	MODERN_STRING_API
+	parse_fields_result parse_double_fields(const ks_wstring_view& str_view, WCHAR delim, double* out, size_t out_capacity, double def_value, std::vector<size_t>* error_positions) {
+		return __do_parse_float_fields<double>(str_view, delim, out, out_capacity, def_value, error_positions);
+	}
+
+	//try parse ...
+	MODERN_STRING_API
+	parse_result<int> try_parse_int(const ks_string_view& str_view, size_t pos, int base) {
+		return __try_parse_intx<int>(str_view, pos, base);
+	}
+	MODERN_STRING_API
+	parse_result<int> try_parse_int(const ks_wstring_view& str_view, size_t pos, int base) {
+		return __try_parse_intx<int>(str_view, pos, base);
+	}
+
+	MODERN_STRING_API
+	parse_result<int8_t> try_parse_int8(const ks_string_view& str_view, size_t pos, int base) {
+		return __try_parse_intx<int8_t>(str_view, pos, base);
+	}
+	MODERN_STRING_API
+	parse_result<int8_t> try_parse_int8(const ks_wstring_view& str_view, size_t pos, int base) {
+		return __try_parse_intx<int8_t>(str_view, pos, base);
+	}
+
+	MODERN_STRING_API
+	parse_result<int16_t> try_parse_int16(const ks_string_view& str_view, size_t pos, int base) {
+		return __try_parse_intx<int16_t>(str_view, pos, base);
+	}
+	MODERN_STRING_API
+	parse_result<int16_t> try_parse_int16(const ks_wstring_view& str_view, size_t pos, int base) {
+		return __try_parse_intx<int16_t>(str_view, pos, base);
+	}
+
+	MODERN_STRING_API
+	parse_result<int32_t> try_parse_int32(const ks_string_view& str_view, size_t pos, int base) {
+		return __try_parse_intx<int32_t>(str_view, pos, base);
+	}
+	MODERN_STRING_API
+	parse_result<int32_t> try_parse_int32(const ks_wstring_view& str_view, size_t pos, int base) {
+		return __try_parse_intx<int32_t>(str_view, pos, base);
+	}
+
+	MODERN_STRING_API
+	parse_result<int64_t> try_parse_int64(const ks_string_view& str_view, size_t pos, int base) {
+		return __try_parse_intx<int64_t>(str_view, pos, base);
+	}
+	MODERN_STRING_API
+	parse_result<int64_t> try_parse_int64(const ks_wstring_view& str_view, size_t pos, int base) {
+		return __try_parse_intx<int64_t>(str_view, pos, base);
+	}
+
+	MODERN_STRING_API
+	parse_result<intptr_t> try_parse_intptr(const ks_string_view& str_view, size_t pos, int base) {
+		return __try_parse_intx<intptr_t>(str_view, pos, base);
+	}
+	MODERN_STRING_API
+	parse_result<intptr_t> try_parse_intptr(const ks_wstring_view& str_view, size_t pos, int base) {
+		return __try_parse_intx<intptr_t>(str_view, pos, base);
+	}
+
+	MODERN_STRING_API
+	parse_result<uint> try_parse_uint(const ks_string_view& str_view, size_t pos, int base) {
+		return __try_parse_intx<uint>(str_view, pos, base);
+	}
+	MODERN_STRING_API
+	parse_result<uint> try_parse_uint(const ks_wstring_view& str_view, size_t pos, int base) {
+		return __try_parse_intx<uint>(str_view, pos, base);
+	}
+
+	MODERN_STRING_API
+	parse_result<uint8_t> try_parse_uint8(const ks_string_view& str_view, size_t pos, int base) {
+		return __try_parse_intx<uint8_t>(str_view, pos, base);
+	}
+	MODERN_STRING_API
+	parse_result<uint8_t> try_parse_uint8(const ks_wstring_view& str_view, size_t pos, int base) {
+		return __try_parse_intx<uint8_t>(str_view, pos, base);
+	}
+
+	MODERN_STRING_API
+	parse_result<uint16_t> try_parse_uint16(const ks_string_view& str_view, size_t pos, int base) {
+		return __try_parse_intx<uint16_t>(str_view, pos, base);
+	}
+	MODERN_STRING_API
+	parse_result<uint16_t> try_parse_uint16(const ks_wstring_view& str_view, size_t pos, int base) {
+		return __try_parse_intx<uint16_t>(str_view, pos, base);
+	}
+
+	MODERN_STRING_API
+	parse_result<uint32_t> try_parse_uint32(const ks_string_view& str_view, size_t pos, int base) {
+		return __try_parse_intx<uint32_t>(str_view, pos, base);
+	}
+	MODERN_STRING_API
+	parse_result<uint32_t> try_parse_uint32(const ks_wstring_view& str_view, size_t pos, int base) {
+		return __try_parse_intx<uint32_t>(str_view, pos, base);
+	}
+
+	MODERN_STRING_API
+	parse_result<uint64_t> try_parse_uint64(const ks_string_view& str_view, size_t pos, int base) {
+		return __try_parse_intx<uint64_t>(str_view, pos, base);
+	}
+	MODERN_STRING_API
+	parse_result<uint64_t> try_parse_uint64(const ks_wstring_view& str_view, size_t pos, int base) {
+		return __try_parse_intx<uint64_t>(str_view, pos, base);
+	}
+
+	MODERN_STRING_API
+	parse_result<uintptr_t> try_parse_uintptr(const ks_string_view& str_view, size_t pos, int base) {
+		return __try_parse_intx<uintptr_t>(str_view, pos, base);
+	}
+	MODERN_STRING_API
+	parse_result<uintptr_t> try_parse_uintptr(const ks_wstring_view& str_view, size_t pos, int base) {
+		return __try_parse_intx<uintptr_t>(str_view, pos, base);
+	}
+
+	MODERN_STRING_API
+	parse_result<float> try_parse_float(const ks_string_view& str_view, size_t pos) {
+		return __try_parse_floatx<float>(str_view, pos);
+	}
+	MODERN_STRING_API
+	parse_result<float> try_parse_float(const ks_wstring_view& str_view, size_t pos) {
+		return __try_parse_floatx<float>(str_view, pos);
+	}
+
+	MODERN_STRING_API
+	parse_result<double> try_parse_double(const ks_string_view& str_view, size_t pos) {
+		return __try_parse_floatx<double>(str_view, pos);
+	}
+	MODERN_STRING_API
+	parse_result<double> try_parse_double(const ks_wstring_view& str_view, size_t pos) {
+		return __try_parse_floatx<double>(str_view, pos);
+	}
+
 }
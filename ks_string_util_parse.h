@@ -103,4 +103,137 @@ namespace ks_string_util {
 	MODERN_STRING_API
 	bool parse_bool(const ks_wstring_view& str_view, bool def_value = false, size_t* pos = nullptr);
 
+	//try parse ...
+	//like parse_xxx, but the error is told apart from the value (no def_value is needed).
+	//parsing begins from pos, consumed is the count of chars taken, and both value and consumed are 0 if error.
+	enum class parse_error {
+		none = 0,
+		empty = 1,    //pos is at the end, no char to parse
+		invalid = 2,  //no digit is taken (or the base is invalid)
+		overflow = 3, //the value is out of range (for float types, the overflow or underflow, like strtod)
+	};
+
+	template <class T>
+	struct parse_result {
+		T value;
+		size_t consumed;
+		parse_error error;
+
+		explicit operator bool() const { return error == parse_error::none; }
+	};
+
+	MODERN_STRING_API
+	parse_result<int> try_parse_int(const ks_string_view& str_view, size_t pos = 0, int base = 0);
+	MODERN_STRING_API
+	parse_result<int> try_parse_int(const ks_wstring_view& str_view, size_t pos = 0, int base = 0);
+
+	MODERN_STRING_API
+	parse_result<int8_t> try_parse_int8(const ks_string_view& str_view, size_t pos = 0, int base = 0);
+	MODERN_STRING_API
+	parse_result<int8_t> try_parse_int8(const ks_wstring_view& str_view, size_t pos = 0, int base = 0);
+
+	MODERN_STRING_API
+	parse_result<int16_t> try_parse_int16(const ks_string_view& str_view, size_t pos = 0, int base = 0);
+	MODERN_STRING_API
+	parse_result<int16_t> try_parse_int16(const ks_wstring_view& str_view, size_t pos = 0, int base = 0);
+
+	MODERN_STRING_API
+	parse_result<int32_t> try_parse_int32(const ks_string_view& str_view, size_t pos = 0, int base = 0);
+	MODERN_STRING_API
+	parse_result<int32_t> try_parse_int32(const ks_wstring_view& str_view, size_t pos = 0, int base = 0);
+
+	MODERN_STRING_API
+	parse_result<int64_t> try_parse_int64(const ks_string_view& str_view, size_t pos = 0, int base = 0);
+	MODERN_STRING_API
+	parse_result<int64_t> try_parse_int64(const ks_wstring_view& str_view, size_t pos = 0, int base = 0);
+
+	MODERN_STRING_API
+	parse_result<intptr_t> try_parse_intptr(const ks_string_view& str_view, size_t pos = 0, int base = 0);
+	MODERN_STRING_API
+	parse_result<intptr_t> try_parse_intptr(const ks_wstring_view& str_view, size_t pos = 0, int base = 0);
+
+	MODERN_STRING_API
+	parse_result<uint> try_parse_uint(const ks_string_view& str_view, size_t pos = 0, int base = 0);
+	MODERN_STRING_API
+	parse_result<uint> try_parse_uint(const ks_wstring_view& str_view, size_t pos = 0, int base = 0);
+
+	MODERN_STRING_API
+	parse_result<uint8_t> try_parse_uint8(const ks_string_view& str_view, size_t pos = 0, int base = 0);
+	MODERN_STRING_API
+	parse_result<uint8_t> try_parse_uint8(const ks_wstring_view& str_view, size_t pos = 0, int base = 0);
+
+	MODERN_STRING_API
+	parse_result<uint16_t> try_parse_uint16(const ks_string_view& str_view, size_t pos = 0, int base = 0);
+	MODERN_STRING_API
+	parse_result<uint16_t> try_parse_uint16(const ks_wstring_view& str_view, size_t pos = 0, int base = 0);
+
+	MODERN_STRING_API
+	parse_result<uint32_t> try_parse_uint32(const ks_string_view& str_view, size_t pos = 0, int base = 0);
+	MODERN_STRING_API
+	parse_result<uint32_t> try_parse_uint32(const ks_wstring_view& str_view, size_t pos = 0, int base = 0);
+
+	MODERN_STRING_API
+	parse_result<uint64_t> try_parse_uint64(const ks_string_view& str_view, size_t pos = 0, int base = 0);
+	MODERN_STRING_API
+	parse_result<uint64_t> try_parse_uint64(const ks_wstring_view& str_view, size_t pos = 0, int base = 0);
+
+	MODERN_STRING_API
+	parse_result<uintptr_t> try_parse_uintptr(const ks_string_view& str_view, size_t pos = 0, int base = 0);
+	MODERN_STRING_API
+	parse_result<uintptr_t> try_parse_uintptr(const ks_wstring_view& str_view, size_t pos = 0, int base = 0);
+
+	MODERN_STRING_API
+	parse_result<float> try_parse_float(const ks_string_view& str_view, size_t pos = 0);
+	MODERN_STRING_API
+	parse_result<float> try_parse_float(const ks_wstring_view& str_view, size_t pos = 0);
+
+	MODERN_STRING_API
+	parse_result<double> try_parse_double(const ks_string_view& str_view, size_t pos = 0);
+	MODERN_STRING_API
+	parse_result<double> try_parse_double(const ks_wstring_view& str_view, size_t pos = 0);
+
+	//parse fields ...
+	//the fields of str_view separated by delim are parsed into out[] in one pass, no field view or vector is made.
+	//note:
+	// each field must be a whole number (no space is skipped), otherwise it is invalid and def_value is stored for it.
+	// an empty str_view has no field, and a trailing delim does not begin an empty last field.
+	// if out[] is full, parsing stops before the next field, and end_pos tells where to continue.
+	// the positions of invalid fields are appended to error_positions, optional.
+	struct parse_fields_result {
+		size_t field_count;     //the count of fields stored into out[]
+		size_t error_count;     //the count of invalid fields
+		size_t first_error_pos; //the position of the first invalid field, or size_t(-1)
+		size_t end_pos;         //the position where parsing stopped
+	};
+
+	MODERN_STRING_API
+	parse_fields_result parse_int32_fields(const ks_string_view& str_view, char delim, int32_t* out, size_t out_capacity, int32_t def_value = 0, int base = 10, std::vector<size_t>* error_positions = nullptr);
+	MODERN_STRING_API
+	parse_fields_result parse_int32_fields(const ks_wstring_view& str_view, WCHAR delim, int32_t* out, size_t out_capacity, int32_t def_value = 0, int base = 10, std::vector<size_t>* error_positions = nullptr);
+
+	MODERN_STRING_API
+	parse_fields_result parse_int64_fields(const ks_string_view& str_view, char delim, int64_t* out, size_t out_capacity, int64_t def_value = 0, int base = 10, std::vector<size_t>* error_positions = nullptr);
+	MODERN_STRING_API
+	parse_fields_result parse_int64_fields(const ks_wstring_view& str_view, WCHAR delim, int64_t* out, size_t out_capacity, int64_t def_value = 0, int base = 10, std::vector<size_t>* error_positions = nullptr);
+
+	MODERN_STRING_API
+	parse_fields_result parse_uint32_fields(const ks_string_view& str_view, char delim, uint32_t* out, size_t out_capacity, uint32_t def_value = 0, int base = 10, std::vector<size_t>* error_positions = nullptr);
+	MODERN_STRING_API
+	parse_fields_result parse_uint32_fields(const ks_wstring_view& str_view, WCHAR delim, uint32_t* out, size_t out_capacity, uint32_t def_value = 0, int base = 10, std::vector<size_t>* error_positions = nullptr);
+
+	MODERN_STRING_API
+	parse_fields_result parse_uint64_fields(const ks_string_view& str_view, char delim, uint64_t* out, size_t out_capacity, uint64_t def_value = 0, int base = 10, std::vector<size_t>* error_positions = nullptr);
+	MODERN_STRING_API
+	parse_fields_result parse_uint64_fields(const ks_wstring_view& str_view, WCHAR delim, uint64_t* out, size_t out_capacity, uint64_t def_value = 0, int base = 10, std::vector<size_t>* error_positions = nullptr);
+
+	MODERN_STRING_API
+	parse_fields_result parse_float_fields(const ks_string_view& str_view, char delim, float* out, size_t out_capacity, float def_value = 0.0, std::vector<size_t>* error_positions = nullptr);
+	MODERN_STRING_API
+	parse_fields_result parse_float_fields(const ks_wstring_view& str_view, WCHAR delim, float* out, size_t out_capacity, float def_value = 0.0, std::vector<size_t>* error_positions = nullptr);
+
+	MODERN_STRING_API
+	parse_fields_result parse_double_fields(const ks_string_view& str_view, char delim, double* out, size_t out_capacity, double def_value = 0.0, std::vector<size_t>* error_positions = nullptr);
+	MODERN_STRING_API
+	parse_fields_result parse_double_fields(const ks_wstring_view& str_view, WCHAR delim, double* out, size_t out_capacity, double def_value = 0.0, std::vector<size_t>* error_positions = nullptr);
+
 }
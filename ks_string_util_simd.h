@@ -0,0 +1,136 @@
+﻿/* Copyright 2024 The Kingsoft's modern-string Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#pragma once
+
+#include "base.h"
+
+//note: this is a private header of modern-string, which is only included by the .cpp files (it is not installed).
+//the sse2 kernels are always enabled on x86/x64 (sse2 is the baseline there),
+//and the avx2 kernels are compiled with the target attribute, then chosen by the runtime cpu detection.
+//on other architectures, only the scalar implementations are used.
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define _KS_SIMD_SSE2  1
+#	include <emmintrin.h>
+#	if defined(__GNUC__) || defined(__clang__)
+#		define _KS_SIMD_AVX2  1
+#		define _KS_TARGET_AVX2  __attribute__((target("avx2")))
+#		include <immintrin.h>
+#	elif defined(_MSC_VER)
+#		define _KS_SIMD_AVX2  1
+#		define _KS_TARGET_AVX2
+#		include <immintrin.h>
+#		include <intrin.h>
+#	endif
+#endif
+
+#ifndef _KS_SIMD_SSE2
+#	define _KS_SIMD_SSE2  0
+#endif
+#ifndef _KS_SIMD_AVX2
+#	define _KS_SIMD_AVX2  0
+#endif
+
+
+namespace ks_string_util {
+	namespace __simd {
+		inline bool cpu_has_avx2() {
+#if _KS_SIMD_AVX2
+#	if defined(_MSC_VER) && !defined(__clang__)
+			static const bool s_has = []() -> bool {
+				int info[4];
+				__cpuid(info, 0);
+				if (info[0] < 7)
+					return false;
+				__cpuid(info, 1);
+				if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0)
+					return false; //no osxsave or no avx
+				if ((_xgetbv(0) & 0x06) != 0x06)
+					return false; //ymm state is not enabled by os
+				__cpuidex(info, 7, 0);
+				return (info[1] & (1 << 5)) != 0;
+			}();
+#	else
+			static const bool s_has = __builtin_cpu_supports("avx2");
+#	endif
+			return s_has;
+#else
+			return false;
+#endif
+		}
+
+		inline uint ctz32(uint32_t x) {
+			ASSERT(x != 0);
+#if defined(_MSC_VER) && !defined(__clang__)
+			unsigned long index;
+			_BitScanForward(&index, x);
+			return (uint)index;
+#else
+			return (uint)__builtin_ctz(x);
+#endif
+		}
+
+		inline uint clz64(uint64_t x) {
+			ASSERT(x != 0);
+#if defined(_MSC_VER) && !defined(__clang__) && defined(_M_X64)
+			unsigned long index;
+			_BitScanReverse64(&index, x);
+			return 63 - (uint)index;
+#elif defined(_MSC_VER) && !defined(__clang__)
+			uint n = 0;
+			while ((x & (uint64_t(1) << 63)) == 0) {
+				x <<= 1;
+				++n;
+			}
+			return n;
+#else
+			return (uint)__builtin_clzll(x);
+#endif
+		}
+
+		//the full 128-bit product of a and b, return the low part and take the high part
+		inline uint64_t umul128(uint64_t a, uint64_t b, uint64_t* high) {
+#if defined(__SIZEOF_INT128__)
+			unsigned __int128 r = (unsigned __int128)a * b;
+			*high = (uint64_t)(r >> 64);
+			return (uint64_t)r;
+#elif defined(_MSC_VER) && !defined(__clang__) && defined(_M_X64)
+			return _umul128(a, b, high);
+#else
+			const uint64_t a_lo = (uint32_t)a, a_hi = a >> 32, b_lo = (uint32_t)b, b_hi = b >> 32;
+			const uint64_t lo_lo = a_lo * b_lo, hi_lo = a_hi * b_lo, lo_hi = a_lo * b_hi, hi_hi = a_hi * b_hi;
+			const uint64_t cross = (lo_lo >> 32) + (uint32_t)hi_lo + lo_hi;
+			*high = hi_hi + (hi_lo >> 32) + (cross >> 32);
+			return (cross << 32) | (uint32_t)lo_lo;
+#endif
+		}
+
+		inline uint popcount32(uint32_t x) {
+			//note: no popcnt instruction is assumed
+			x = x - ((x >> 1) & 0x55555555);
+			x = (x & 0x33333333) + ((x >> 2) & 0x33333333);
+			x = (x + (x >> 4)) & 0x0F0F0F0F;
+			return (uint)((x * 0x01010101) >> 24);
+		}
+
+#if _KS_SIMD_SSE2
+		//unsigned byte-wise compare: x >= k
+		inline __m128i cmpge_epu8(__m128i x, __m128i k) {
+			return _mm_cmpeq_epi8(_mm_max_epu8(x, k), x);
+		}
+#endif
+	}
+}